@@ -820,6 +820,9 @@ static void system_clock_108m_hxtal(void)
     while(0U == (RCU_CTL & RCU_CTL_PLLSTB)){
     }
 
+    /* two flash wait states for 108 MHz, set while the core still runs on HXTAL */
+    FMC_WS = (FMC_WS & ~FMC_WS_WSCNT) | WS_WSCNT_2;
+
     /* select PLL as system clock */
     RCU_CFG0 &= ~RCU_CFG0_SCS;
     RCU_CFG0 |= RCU_CKSYSSRC_PLL;
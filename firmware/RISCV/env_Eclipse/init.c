@@ -24,9 +24,9 @@ void _init()
 	//pmp_open_all_space();
 	//switch_m2u_mode();
 	
-    /* Before enter into main, add the cycle/instret disable by default to save power,
-    only use them when needed to measure the cycle/instret */
-	disable_mcycle_minstret();
+    /* mcycle is left counting (start.S enables it), the application times
+    with it */
+	//disable_mcycle_minstret();
 }
 
 void _fini()
@@ -8,49 +8,75 @@
 
 #include "at_command.h"
 #include "drivers.h"
+#include "logger.h"
+#include "ramfunc.h"
 
 uint8_t ok_end_sequence_matches = 0;
 uint8_t error_end_sequence_matches = 0;
 DATA_TRANSMIT_STATE transmit_state = READY_TO_SEND;
+static const char *volatile current_command = NULL;   // Named in the log if it fails
 
 /**
- * @brief      Get last return and save it to a string for easier handling.
+ * @brief      Reverses string[first..last], for the rotation below.
+ */
+static void _reverse(char *string, int first, int last) {
+    char swap;
+
+    while(first < last)
+    {
+        swap = string[first];
+        string[first++] = string[last];
+        string[last--] = swap;
+    }
+}
+
+/**
+ * @brief      Get last return and save it to a string for easier handling. The
+ *             return is read straight into the string, which is used as a ring
+ *             once it is full, so no second receive sized buffer is needed. The
+ *             ring is then rotated in place so the last characters come out in
+ *             order.
  * @param[out] string String to put the return contents in.
- * @param      string_len The maximum length of the string.
- * @return     The length of the data that was stored in the string.
+ * @param      string_len The maximum length of the string, terminator included.
  */
 void get_last_return_string(char *string, int string_len) {
+    int capacity = string_len - 1;      // Characters kept, the last ones
     int return_length = 0;
-    int buffer_ptr = 0;
-    int string_ptr = string_len - 1;
-    char buffer[RECIEVE_BUFFER_SIZE] = {0};
     char current_char;
 
-    while((current_char = getChar()) != '\0')
+    if (capacity <= 0)
     {
-        buffer[buffer_ptr] = current_char;
-        buffer_ptr++;
-        return_length++;
+        while(getChar() != '\0');
+        if (string_len > 0)
+            string[0] = '\0';
+        return;
     }
 
-    if (return_length > string_len)
-        while(string_ptr >= 0)
-            string[string_ptr--] = buffer[buffer_ptr--];
-    else
-        strncpy(string, buffer, string_len);
+    while(return_length < RECIEVE_BUFFER_SIZE && (current_char = getChar()) != '\0')
+        string[return_length++ % capacity] = current_char;
 
-    return return_length;
+    if (return_length > capacity)
+    {
+        int oldest = return_length % capacity;
 
+        _reverse(string, 0, oldest - 1);
+        _reverse(string, oldest, capacity - 1);
+        _reverse(string, 0, capacity - 1);
+        return_length = capacity;
+    }
+    string[return_length] = '\0';
 }
 
 /**
  * @brief       callback function for the uart data recieve callback. Its' purpose is to
  *              determine when the wifi module has finished sending data.
+ *              Called by the USART0 handler for every byte, so it runs from
+ *              SRAM; only the error log goes out to flash.
  * 
  * @param[in]   recieved_data: the data recived by the UART0 interface.
  * @return      no return value. 
  */
-void wifi_uart_data_recieved_callback(uint8_t recieved_data)
+RAMFUNC void wifi_uart_data_recieved_callback(uint8_t recieved_data)
 {
     if (recieved_data == AT_RECIEVE_OK[ok_end_sequence_matches])
     {
@@ -74,42 +100,10 @@ void wifi_uart_data_recieved_callback(uint8_t recieved_data)
         {
             //transmit_state = AT_DONE; // Don't allow to continue
             error_end_sequence_matches = 0;
-#ifdef DEBUG
-            char string_return[RECIEVE_BUFFER_SIZE + 1] = {'\0'};
-            char at_command[RECIEVE_BUFFER_SIZE + 1] = {'\0'};
-            char at_message[RECIEVE_BUFFER_SIZE + 1] = {'\0'};
-            get_last_return_string(string_return, RECIEVE_BUFFER_SIZE);
-            char debug_message[1024] = {'\0'};
-
-            int string_return_ptr = 0;
-            int sub_str_ptr = 0;
-            while(string_return_ptr < RECIEVE_BUFFER_SIZE) {
-                if (string_return[string_return_ptr] == '\r' && string_return[string_return_ptr + 1] == '\n') {
-                    string_return_ptr += 2;
-                    break;
-                } else {
-                    at_command[sub_str_ptr++] = string_return[string_return_ptr++];
-                }
-            }
-
-            sub_str_ptr = 0;
-            while(string_return_ptr < RECIEVE_BUFFER_SIZE) {
-                if (string_return[string_return_ptr] == '\r' && string_return[string_return_ptr + 1] == '\n') {
-                    string_return_ptr += 2;
-                    if (sub_str_ptr > 0)
-                        at_message[sub_str_ptr++] = ';';
-                } else {
-                    at_message[sub_str_ptr++] = string_return[string_return_ptr++];
-                }
-            }
-
-            strncpy(debug_message, "AT command (", RECIEVE_BUFFER_SIZE);
-            strncat(debug_message, at_command, RECIEVE_BUFFER_SIZE);
-            strncat(debug_message, ") ", RECIEVE_BUFFER_SIZE);
-            strncat(debug_message, "returned an error: ", RECIEVE_BUFFER_SIZE);
-            strncat(debug_message, at_message, RECIEVE_BUFFER_SIZE);
-            debug_error_message_custom(debug_message);
-#endif
+            if (current_command)
+                LOG_STRING(LOG_LEVEL_ERROR, "AT command (%s) returned an error", current_command);
+            else
+                LOG_ERROR("AT command returned an error");
         }
     }
     else
@@ -175,6 +169,43 @@ int8_t _is_command_length_within_limits(char * at_command)
     return -1;
 }
 
+/**
+ * @brief       Spins until the ESP8266 module has answered with OK or the response
+ *              times out after 3 seconds.
+ * 
+ * @param       void: no arguments.
+ * @return      no return value.
+ */
+static void _wait_for_response()
+{
+    int ms = 0;
+    while(1)
+    {
+        DATA_TRANSMIT_STATE current_state = _get_transmit_state();
+        if (current_state == WAITING)
+        {
+            // TODO: A timeout is REALLY needed here. Sometimes commands are not understood and then there will
+            //  never be any OK or ERROR sent. Now execution stops here on every other reboot because the device
+            //  randomly resets and during this reset, commands won't be understood.
+            u0_TX_Queue();
+            LCD_WR_Queue();             // Let the LCD power up meanwhile
+            if (t5expq())
+            {
+                ms++;
+                if (ms == 3000)
+                {
+                    TRACE_INSTANT(TRACE_AT_TIMEOUT, 0);
+                    LOG_WARN("AT command timed out after %d ms", ms);
+                    transmit_state = AT_TIMEOUT;
+                    break;
+                }
+            }
+            continue;
+        }
+        break;
+    }
+}
+
 /**
  * @brief       Sends an AT command to the ESP8266 module through uart.
  * 
@@ -194,35 +225,18 @@ int at_send(char *at_command, uint8_t response_falg)
         return -1;
     }
 
+    TRACE_BEGIN(TRACE_AT_COMMAND, strlen(at_command));
+    LOG_STRING(LOG_LEVEL_DEBUG, "AT > %s", at_command);
+    current_command = at_command;
     putstr(at_command);
     _set_transmit_state_waiting();
     
     if (response_falg == WAIT_FOR_RESPONSE)
     {
-        int ms = 0;
-        while(1)
-        {
-            DATA_TRANSMIT_STATE current_state = _get_transmit_state();
-            if (current_state == WAITING)
-            {
-                // TODO: A timeout is REALLY needed here. Sometimes commands are not understood and then there will
-                //  never be any OK or ERROR sent. Now execution stops here on every other reboot because the device
-                //  randomly resets and during this reset, commands won't be understood.
-                u0_TX_Queue();
-                if (t5expq())
-                {
-                    ms++;
-                    if (ms == 3000)
-                    {
-                        transmit_state = AT_TIMEOUT;
-                        break;
-                    }
-                }
-                continue;
-            }
-            break;
-        }
+        _wait_for_response();
     }
+    current_command = NULL;
+    TRACE_END(TRACE_AT_COMMAND, 0);
 
     #ifdef AT_COMMAND_COMMUNICATION_LCD_LOGGING
     int i = 0, j = 0; 
@@ -239,4 +253,31 @@ int at_send(char *at_command, uint8_t response_falg)
     #endif
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief       Sends raw bytes (which may contain '\0') to the ESP8266 module, e.g. the
+ *              payload after a "AT+MQTTPUBRAW" command has been accepted.
+ * 
+ * @param[in]   data: the bytes to send.
+ * @param[in]   length: the number of bytes.
+ * @param[in]   response_falg: WAIT_FOR_RESPONSE to wait for the module's OK.
+ * @return      0 is returned when the data has been queued (and answered).
+ */
+int at_send_raw(const uint8_t *data, uint16_t length, uint8_t response_falg)
+{
+    while(getChar() != '\0');
+
+    _set_transmit_state_waiting();
+    while(length--)
+    {
+        putch((char) *data++);
+    }
+
+    if (response_falg == WAIT_FOR_RESPONSE)
+    {
+        _wait_for_response();
+    }
+
+    return 0;
+}
@@ -36,6 +36,7 @@
 #include "usart.h" /* at_send() won't run without */
 #include "lcd.h"
 #include "debug.h"
+#include "trace.h"
 
 typedef enum {
     READY_TO_SEND = 0,
@@ -46,6 +47,7 @@ typedef enum {
 } DATA_TRANSMIT_STATE;
 
 int at_send(char *at_command, uint8_t response_falg);
+int at_send_raw(const uint8_t *data, uint16_t length, uint8_t response_falg);
 void wifi_uart_data_recieved_callback(uint8_t recieved_data);
 void get_last_return_string(char *string, int string_len);
 DATA_TRANSMIT_STATE _get_transmit_state();
@@ -0,0 +1,145 @@
+/**
+ * @file        change_detect.c
+ * @brief       Streaming change-point detection for one temperature sensor: a 
+ *              two-sided CUSUM against a slowly adapting reference plus a 
+ *              rate-of-change trigger, all in integer arithmetic.
+ * @version     0.1
+ * @date        2022-03-10
+ */
+
+#include "change_detect.h"
+
+/**
+ * @brief       Initializes a detector.
+ *
+ * @param[out]  detector: the detector to initialize.
+ * @param[in]   config: the tuning, must outlive the detector.
+ *
+ * @return      None.
+ */
+void change_detect_init(change_detect_t *detector, const change_detect_config_t *config)
+{
+    detector->config = config;
+    temp_stats_ewma_init(&detector->reference, config->reference_alpha);
+    detector->warmup_sum = 0;
+    detector->sum_high = 0;
+    detector->sum_low = 0;
+    detector->rate_anchor = 0;
+    detector->rate_anchor_ms = 0;
+    detector->rate_high = false;
+    detector->count = 0;
+    detector->status = CHANGE_DETECT_OK;
+}
+
+/**
+ * @return      The current in-control reference temperature in Q7.8.
+ */
+temp_q8_t change_detect_reference(const change_detect_t *detector)
+{
+    return temp_q8_round(detector->reference.value, TEMP_Q8_FRAC_BITS + TEMP_STATS_FRAC_BITS);
+}
+
+/**
+ * @brief       Measures the change since the rate anchor once rate_span_ms has
+ *              passed, and moves the anchor to the current sample. The result
+ *              is held until the next span is complete, so a rate event keeps
+ *              CHECK for at least one span instead of ending on the next sample.
+ *
+ * @return      true if the change over the last complete span exceeded the rate limit.
+ */
+static bool _rate_exceeded(change_detect_t *detector, temp_q8_t sample, uint32_t timestamp_ms)
+{
+    const change_detect_config_t *config = detector->config;
+    uint32_t elapsed_ms = timestamp_ms - detector->rate_anchor_ms;
+
+    if (elapsed_ms < config->rate_span_ms)
+        return detector->rate_high;
+
+    int32_t change = sample - detector->rate_anchor;
+    detector->rate_anchor = sample;
+    detector->rate_anchor_ms = timestamp_ms;
+
+    /* Normalize to the configured span so late samples don't look steeper */
+    int32_t change_per_span = (int32_t) ((int64_t) change * config->rate_span_ms / elapsed_ms);
+    if (change_per_span < 0)
+        change_per_span = -change_per_span;
+    detector->rate_high = change_per_span > config->rate_limit;
+    return detector->rate_high;
+}
+
+/**
+ * @brief       Feeds one sample through the detector.
+ *
+ * @param[out]  detector: the detector.
+ * @param[in]   sample: the temperature in Q7.8.
+ * @param[in]   timestamp_ms: when the sample was taken, in milliseconds (may wrap).
+ * @param[out]  event: filled in when the status changes, may be NULL.
+ *
+ * @return      true if the status changed (OK -> CHECK or CHECK -> OK).
+ */
+bool change_detect_update(change_detect_t *detector, temp_q8_t sample, uint32_t timestamp_ms,
+                          change_detect_event_t *event)
+{
+    const change_detect_config_t *config = detector->config;
+
+    /* Learn the reference as a plain mean of the first samples */
+    if (detector->count < config->warmup) {
+        detector->count++;
+        detector->warmup_sum += sample;
+        if (detector->count == config->warmup)
+            temp_stats_ewma_set(&detector->reference,
+                                (detector->warmup_sum * (1 << TEMP_STATS_FRAC_BITS)) / config->warmup);
+        detector->rate_anchor = sample;
+        detector->rate_anchor_ms = timestamp_ms;
+        return false;
+    }
+
+    int32_t residual = sample - change_detect_reference(detector);
+
+    detector->sum_high += residual - config->drift;
+    if (detector->sum_high < 0)
+        detector->sum_high = 0;
+    detector->sum_low += -residual - config->drift;
+    if (detector->sum_low < 0)
+        detector->sum_low = 0;
+
+    bool rate_exceeded = _rate_exceeded(detector, sample, timestamp_ms);
+    CHANGE_DETECT_CAUSE cause = CHANGE_CAUSE_NONE;
+
+    if (detector->status == CHANGE_DETECT_OK) {
+        if (detector->sum_high > config->threshold)
+            cause = CHANGE_CAUSE_RISE;
+        else if (detector->sum_low > config->threshold)
+            cause = CHANGE_CAUSE_DROP;
+        else if (rate_exceeded)
+            cause = CHANGE_CAUSE_RATE;
+
+        if (cause == CHANGE_CAUSE_NONE) {
+            /* Only in-control samples may move the reference */
+            if (residual <= config->drift && residual >= -config->drift)
+                temp_stats_ewma_update(&detector->reference, sample);
+            return false;
+        }
+
+        detector->status = CHANGE_DETECT_CHECK;
+    } else {
+        /* Cap the sums so recovery time doesn't grow with the length of the event */
+        if (detector->sum_high > 2 * config->threshold)
+            detector->sum_high = 2 * config->threshold;
+        if (detector->sum_low > 2 * config->threshold)
+            detector->sum_low = 2 * config->threshold;
+
+        /* Back to OK once the samples have returned to the reference long enough */
+        if (detector->sum_high || detector->sum_low || rate_exceeded)
+            return false;
+
+        detector->status = CHANGE_DETECT_OK;
+    }
+
+    if (event) {
+        event->status = detector->status;
+        event->cause = cause;
+        event->timestamp_ms = timestamp_ms;
+    }
+    return true;
+}
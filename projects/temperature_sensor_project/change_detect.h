@@ -0,0 +1,84 @@
+/**
+ * @file        change_detect.h
+ * @brief       Streaming change-point detection for one temperature sensor: a 
+ *              two-sided CUSUM against a slowly adapting reference plus a 
+ *              rate-of-change trigger, all in integer arithmetic.
+ * @version     0.1
+ * @date        2022-03-10
+ */
+
+#ifndef CHANGE_DETECT_H
+#define CHANGE_DETECT_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "temp_fixed.h"
+#include "temp_stats.h"
+
+typedef enum {
+    CHANGE_DETECT_OK,           // Temp. follows the reference
+    CHANGE_DETECT_CHECK         // A change has been detected
+} CHANGE_DETECT_STATUS;
+
+typedef enum {
+    CHANGE_CAUSE_NONE,
+    CHANGE_CAUSE_RISE,          // Upper CUSUM crossed the threshold (e.g. heating)
+    CHANGE_CAUSE_DROP,          // Lower CUSUM crossed the threshold (e.g. door open)
+    CHANGE_CAUSE_RATE           // Rate of change exceeded the limit
+} CHANGE_DETECT_CAUSE;
+
+/**
+ * @brief Tuning of a detector. Temperatures are Q7.8.
+ */
+typedef struct {
+    temp_q8_t drift;            // k: deviation per sample that is tolerated as noise
+    int32_t threshold;          // h: accumulated deviation (Q7.8 * samples) that raises CHECK
+    temp_q8_t rate_limit;       // Largest tolerated change per rate_span_ms
+    uint32_t rate_span_ms;      // Time span the rate of change is measured over
+    uint16_t reference_alpha;   // EWMA weight of an in-control sample in the reference, in 1/256
+    uint8_t warmup;             // Samples averaged before the reference is trusted
+} change_detect_config_t;
+
+/**
+ * @brief A status transition.
+ */
+typedef struct {
+    CHANGE_DETECT_STATUS status;
+    CHANGE_DETECT_CAUSE cause;
+    uint32_t timestamp_ms;      // Timestamp of the sample that caused the transition
+} change_detect_event_t;
+
+/**
+ * @brief State of one detector.
+ */
+typedef struct {
+    const change_detect_config_t *config;
+    temp_stats_ewma_t reference;
+    int32_t warmup_sum;
+    int32_t sum_high;
+    int32_t sum_low;
+    temp_q8_t rate_anchor;
+    uint32_t rate_anchor_ms;
+    bool rate_high;             // Result of the last complete rate span
+    uint32_t count;
+    CHANGE_DETECT_STATUS status;
+} change_detect_t;
+
+/**
+ * @brief Default tuning for a refrigerator sampled roughly once a second.
+ */
+#define CHANGE_DETECT_DEFAULT_CONFIG {                  \
+    .drift = TEMP_Q8_FROM_TENTHS(3),                    \
+    .threshold = TEMP_Q8_FROM_INT(2),                   \
+    .rate_limit = TEMP_Q8_FROM_TENTHS(8),               \
+    .rate_span_ms = 10000,                              \
+    .reference_alpha = TEMP_STATS_ALPHA(1, 128),        \
+    .warmup = 10,                                       \
+}
+
+void change_detect_init(change_detect_t *detector, const change_detect_config_t *config);
+bool change_detect_update(change_detect_t *detector, temp_q8_t sample, uint32_t timestamp_ms,
+                          change_detect_event_t *event);
+temp_q8_t change_detect_reference(const change_detect_t *detector);
+
+#endif /* CHANGE_DETECT_H */
@@ -0,0 +1,192 @@
+/**
+ * @file        clock.c
+ * @brief       Core clock profiles, see clock.h.
+ * @version     0.1
+ * @date        2022-03-24
+ */
+
+#include "clock.h"
+#include "gd32vf103.h"
+#include "riscv_encoding.h"
+#include "trace.h"
+#include "logger.h"
+
+static const uint32_t pll_mul[CLOCK_PROFILES] = {
+    [CLOCK_8MHZ]   = 0,                 // No PLL
+    [CLOCK_48MHZ]  = RCU_PLL_MUL12,     // 4 MHz in from PREDV0
+    [CLOCK_96MHZ]  = RCU_PLL_MUL24,
+    [CLOCK_108MHZ] = RCU_PLL_MUL27,
+};
+
+static const uint32_t flash_wait[CLOCK_PROFILES] = {
+    [CLOCK_8MHZ]   = WS_WSCNT_0,        // Up to 24 MHz
+    [CLOCK_48MHZ]  = WS_WSCNT_1,        // Up to 48 MHz
+    [CLOCK_96MHZ]  = WS_WSCNT_2,
+    [CLOCK_108MHZ] = WS_WSCNT_2,
+};
+
+static const clock_client_t *clients[CLOCK_MAX_CLIENTS];
+static int client_count;
+static clock_profile_t current = CLOCK_108MHZ;
+static clock_profile_t target = CLOCK_108MHZ;
+static int bursts;
+
+/**
+ * @brief       Moves the core to HXTAL, sets the flash wait states of the
+ *              profile, sets up and locks the PLL for the profile and moves
+ *              back onto it. The wait states change while the core runs at
+ *              8 MHz, where any count is safe. TIMER5 is given the prescaler
+ *              that keeps its 1 MHz count. The AHB and APB dividers are the
+ *              ones SystemInit() set and are not touched.
+ *
+ * @return      CLOCK_OK, or CLOCK_ERROR if the PLL did not lock; the core is
+ *              then left on HXTAL.
+ */
+static int _configure(clock_profile_t profile)
+{
+    int result = CLOCK_OK;
+
+    rcu_system_clock_source_config(RCU_CKSYSSRC_HXTAL);
+    while (rcu_system_clock_source_get() != RCU_SCSS_HXTAL)
+        ;
+    rcu_osci_off(RCU_PLL_CK);
+    fmc_wscnt_set(flash_wait[profile]);
+
+    if (pll_mul[profile]) {
+        rcu_predv0_config(RCU_PREDV0SRC_HXTAL, RCU_PREDV0_DIV2);
+        rcu_pll_config(RCU_PLLSRC_HXTAL, pll_mul[profile]);
+        rcu_osci_on(RCU_PLL_CK);
+        if (rcu_osci_stab_wait(RCU_PLL_CK) == SUCCESS) {
+            rcu_system_clock_source_config(RCU_CKSYSSRC_PLL);
+            while (rcu_system_clock_source_get() != RCU_SCSS_PLL)
+                ;
+        } else {
+            rcu_osci_off(RCU_PLL_CK);
+            fmc_wscnt_set(flash_wait[CLOCK_8MHZ]);
+            result = CLOCK_ERROR;
+        }
+    }
+
+    SystemCoreClockUpdate();
+    TIMER_PSC(TIMER5) = SystemCoreClock / 1000000 - 1;  // Loaded at the next ms tick
+    return result;
+}
+
+/**
+ * @brief       Moves to CLOCK_IDLE_PROFILE. Call once the drivers that
+ *              register clients are initialised.
+ *
+ * @return      None.
+ */
+void clock_init(void)
+{
+    target = CLOCK_IDLE_PROFILE;
+    clock_poll();
+}
+
+/**
+ * @brief       Adds a driver to be asked before and told after every switch.
+ *
+ * @param[in]   client: kept by reference, so it must be static.
+ *
+ * @return      0 on success, -1 if CLOCK_MAX_CLIENTS are registered already.
+ */
+int clock_register(const clock_client_t *client)
+{
+    if (client_count >= CLOCK_MAX_CLIENTS)
+        return -1;
+    clients[client_count++] = client;
+    return 0;
+}
+
+/**
+ * @brief       Switches to a profile with interrupts off, if every client is
+ *              ready for it.
+ *
+ * @param[in]   profile: the profile to run at.
+ *
+ * @return      CLOCK_OK, CLOCK_BUSY if a client refused, or CLOCK_ERROR if
+ *              the PLL did not lock (now at CLOCK_8MHZ).
+ */
+int clock_set(clock_profile_t profile)
+{
+    uint32_t status, old_hz;
+    int i, result;
+
+    if (profile == current)
+        return CLOCK_OK;
+
+    status = read_csr(mstatus);
+    clear_csr(mstatus, MSTATUS_MIE);
+    for (i = 0; i < client_count; i++) {
+        if (clients[i]->ready && !clients[i]->ready()) {
+            write_csr(mstatus, status);
+            return CLOCK_BUSY;
+        }
+    }
+
+    old_hz = SystemCoreClock;
+    result = _configure(profile);
+    current = result == CLOCK_OK ? profile : CLOCK_8MHZ;
+    if (SystemCoreClock != old_hz) {
+        TRACE_INSTANT(TRACE_CLOCK, (old_hz / 1000000) << 8 | SystemCoreClock / 1000000);
+        logger_clock(old_hz, SystemCoreClock);
+        for (i = 0; i < client_count; i++)
+            clients[i]->changed(old_hz, SystemCoreClock);
+    }
+    write_csr(mstatus, status);
+    return result;
+}
+
+clock_profile_t clock_get(void)
+{
+    return current;
+}
+
+/**
+ * @brief       Restores the current profile after deep-sleep, which stops
+ *              HXTAL and the PLL. SystemInit() goes to 108 MHz first, with
+ *              the wait states for it. The clock ends up as before, so the
+ *              clients are not told.
+ *
+ * @return      None.
+ */
+void clock_resume(void)
+{
+    SystemInit();                       // HXTAL and the PLL at 108 MHz
+    if (current != CLOCK_108MHZ)
+        _configure(current);
+}
+
+/**
+ * @brief       Runs at CLOCK_BURST_PROFILE until the matching
+ *              clock_burst_end(). Bursts may nest.
+ *
+ * @return      None.
+ */
+void clock_burst_begin(void)
+{
+    if (bursts++ == 0) {
+        target = CLOCK_BURST_PROFILE;
+        clock_poll();
+    }
+}
+
+void clock_burst_end(void)
+{
+    if (bursts && --bursts == 0) {
+        target = CLOCK_IDLE_PROFILE;
+        clock_poll();
+    }
+}
+
+/**
+ * @brief       Retries a switch that a client refused. Call every ms tick.
+ *
+ * @return      None.
+ */
+void clock_poll(void)
+{
+    if (current != target && clock_set(target) == CLOCK_ERROR)
+        target = current;               // No PLL, stay on HXTAL
+}
@@ -0,0 +1,79 @@
+/**
+ * @file        clock.h
+ * @brief       Core clock profiles. The core runs from the 8 MHz crystal
+ *              (HXTAL), directly or through the PLL, with AHB = core,
+ *              APB2 = core and APB1 = core/2 in every profile, so the TIMER5
+ *              clock (2 * APB1) is the core clock too.
+ *
+ *              A driver whose timing depends on the clock registers a client.
+ *              Before a switch every client's ready() is asked whether it may
+ *              happen now (nothing in flight on its bus); if one says no,
+ *              clock_set() returns CLOCK_BUSY and nothing is changed. After the
+ *              switch changed() is called, still with interrupts off, to
+ *              recompute baud rates, prescalers and pending deadlines.
+ *
+ *              With CLOCK_SCALING the main loop runs at CLOCK_IDLE_PROFILE and
+ *              code that needs the speed brackets itself with
+ *              clock_burst_begin() and clock_burst_end(). A switch that is
+ *              refused is retried by clock_poll() on the next ms tick.
+ *
+ *              Every profile programs its flash wait states (FMC_WS): none up
+ *              to 24 MHz, one up to 48 MHz and two above. SystemInit() sets
+ *              the two of 108 MHz before it moves onto the PLL, so nothing
+ *              runs at 108 MHz on the reset value of none. Each switch is
+ *              recorded in the trace as a TRACE_CLOCK event and in the log
+ *              as a clock record, which tools/trace_export.py and
+ *              tools/log_decode.py use to turn mcycle time stamps into
+ *              seconds.
+ * @version     0.1
+ * @date        2022-03-24
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "stdint.h"
+
+/**
+ * @brief If defined, the clock drops to CLOCK_IDLE_PROFILE outside bursts,
+ *        else it stays at 108 MHz.
+ */
+//#define CLOCK_SCALING
+
+typedef enum {
+    CLOCK_8MHZ,                         // HXTAL, PLL off
+    CLOCK_48MHZ,
+    CLOCK_96MHZ,
+    CLOCK_108MHZ,                       // As set up by SystemInit()
+    CLOCK_PROFILES
+} clock_profile_t;
+
+#ifdef CLOCK_SCALING
+#define CLOCK_IDLE_PROFILE      CLOCK_48MHZ     // 8 MHz is too slow for the 1-Wire read slots
+#else
+#define CLOCK_IDLE_PROFILE      CLOCK_108MHZ
+#endif
+#define CLOCK_BURST_PROFILE     CLOCK_108MHZ
+
+#define CLOCK_MAX_CLIENTS       4
+#define CLOCK_SWITCH_US         500     // Longest switch, PLL lock included
+
+#define CLOCK_OK                0
+#define CLOCK_BUSY              -1      // A client was not ready, try again later
+#define CLOCK_ERROR             -2      // The PLL did not lock, back on HXTAL
+
+typedef struct {
+    int (*ready)(void);                                 // May be NULL
+    void (*changed)(uint32_t old_hz, uint32_t new_hz);
+} clock_client_t;
+
+void clock_init(void);
+int clock_register(const clock_client_t *client);
+int clock_set(clock_profile_t profile);
+clock_profile_t clock_get(void);
+void clock_resume(void);
+void clock_burst_begin(void);
+void clock_burst_end(void);
+void clock_poll(void);
+
+#endif /* CLOCK_H */
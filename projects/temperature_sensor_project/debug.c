@@ -7,64 +7,175 @@
  */
 
 #include "debug.h"
+#include "stdio.h"
+#include "status_display.h"
 
 #ifdef DEBUG
+static int report_row;
+
 /**
- * @brief      Helper function to get number of digits in an integer number.
- * @param      number The integer to get the number of digits for.
- * @return     The number of digits in the number.
+ * @brief      Shows one line of a report, as many as fit on the screen.
+ * @param[in]  line The line to show.
+ * @return     Nothing.
  */
-int _get_digits_of_int(int number) {
-    int number_digits = 1;
-    int number_calc = number;
-    while((number_calc = number_calc / 10) >= 1)
-        number_digits++;
-    return number_digits;
+static void _show_report_line(const char *line) {
+    if (report_row * 16 < LCD_H)
+        LCD_ShowString(0, report_row++ * 16, (const u8 *) line, WHITE);
 }
 
+#ifdef PROFILE
 /**
- * @brief      Display a debug message along with the current filename and line it is connected to.
- * @param[in]  file_name The name of the file (should be __FILE__)
- * @param      file_line The caller line (should be __LINE__)
- * @param[in]  message The error message to send.
+ * @brief      Display the profiler report (the regions using most cycles).
  * @return     Nothing.
  */
-void debug_error_message(const char *file_name, int file_line, char *message) {
-    char line_file_name[21] = {'\0'};
-    char line_message[61] = {'\0'};
+void debug_profile_report(void) {
+    LCD_Clear(BLACK);
+    report_row = 0;
+    profile_report(&_show_report_line, 1);
+}
+#endif /* PROFILE */
 
-    if (strlen(file_name) > (sizeof line_file_name) - 1)
-        strncpy(line_message, "debug_error_message USAGE ERROR         Too long file name.", (sizeof line_message) - 1);
-    else if (strlen(message) > (sizeof line_message) - 1)
-        strncpy(line_message, "debug_error_message USAGE ERROR         Too long message.", (sizeof line_message) - 1);
-    else
-        strncpy(line_message, (char *) message, (sizeof line_message) - 1);
+/**
+ * @brief      Display the sleep residency and the worst wake-up latencies.
+ * @return     Nothing.
+ */
+void debug_power_report(void) {
+    LCD_Clear(BLACK);
+    report_row = 0;
+    power_report(&_show_report_line);
+}
+
+#ifdef ECLICW_STATS
+/**
+ * @brief      Display the mean and longest cycles of the interrupt handlers
+ *             run from SRAM, as timed by eclicw_dispatch. Build without
+ *             RAMFUNC_ENABLE for the flash figures.
+ * @return     Nothing.
+ */
+void debug_irq_report(void) {
+    static const struct {
+        const char *name;
+        int irqn;
+    } handlers[] = {
+        { "1wire", CLIC_INT_TMR },
+        { "uart0", USART0_IRQn },
+        { "lcdma", DMA0_Channel4_IRQn },
+    };
+    char line[24];
+    unsigned i;
+
+    LCD_Clear(BLACK);
+    report_row = 0;
+    _show_report_line("irq     mean     max");
+    for (i = 0; i < sizeof handlers / sizeof handlers[0]; i++) {
+        const eclicw_stats_t *s = eclicw_stats(handlers[i].irqn);
+
+        snprintf(line, sizeof line, "%-5s %6lu %7lu", handlers[i].name,
+                 (unsigned long) (s->count ? s->cycles_total / s->count : 0), (unsigned long) s->cycles_max);
+        _show_report_line(line);
+    }
+}
+#endif /* ECLICW_STATS */
 
-    strncpy(line_file_name, (char *) file_name, (sizeof line_file_name) - 1);
+#ifdef RAMFUNC_BENCHMARK
+/**
+ * @brief      Display the cycles of the benchmark kernels run from flash and from SRAM.
+ * @return     Nothing.
+ */
+void debug_ramfunc_benchmark(void) {
+    LCD_Clear(BLACK);
+    report_row = 0;
+    ramfunc_benchmark(&_show_report_line);
+}
+#endif /* RAMFUNC_BENCHMARK */
 
+#ifdef MEM_BENCHMARK
+/**
+ * @brief      Display the cycles of the memory functions against byte loops.
+ * @return     Nothing.
+ */
+void debug_mem_benchmark(void) {
     LCD_Clear(BLACK);
-    LCD_ShowString(0, 0, (const u8 *) line_file_name, WHITE);
-    LCD_ShowNum(0, 16, file_line, _get_digits_of_int(file_line), WHITE);
-    LCD_ShowString(0, 32, (const u8 *) line_message, WHITE);
+    report_row = 0;
+    mem_benchmark(&_show_report_line);
 }
+#endif /* MEM_BENCHMARK */
 
+#ifdef LCD_BENCHMARK
 /**
- * @brief      Display a customized debug message that may use the entire screen.
- * @param[in]  message The error message to send.
+ * @brief      Display the characters per second of the per-pixel text renderer
+ *             (before) and of the glyph cache and runs (after), with the SPI
+ *             transfer and for the CPU alone (cpu rows).
  * @return     Nothing.
  */
-void debug_error_message_custom(char *message) {
-    char line_message[101] = {'\0'};
+void debug_lcd_benchmark(void) {
+    const u32 count = 100;              // One screen
+    u32 sent[2][2], queued[2][2];
+    char line[24];
+    int mode, reference;
 
-    strncpy(line_message, (char *) message, (sizeof line_message) - 1);
+    for (mode = 0; mode < 2; mode++)
+        for (reference = 0; reference < 2; reference++)
+            sent[mode][reference] = LCD_BenchmarkText(mode, !reference, count, &queued[mode][reference]);
 
-    if (strlen(message) > (sizeof line_message) - 1) {
-        line_message[100 - 3] = '.';
-        line_message[100 - 2] = '.';
-        line_message[100 - 1] = '.';
+    LCD_Clear(BLACK);
+    report_row = 0;
+    _show_report_line("char/s before  after");
+    for (mode = 0; mode < 2; mode++) {
+        snprintf(line, sizeof line, "%s %6lu %6lu", mode ? "transp" : "opaque",
+                 (unsigned long) sent[mode][0], (unsigned long) sent[mode][1]);
+        _show_report_line(line);
+    }
+    for (mode = 0; mode < 2; mode++) {
+        snprintf(line, sizeof line, "cpu %s %6lu %6lu", mode ? "tr" : "op",
+                 (unsigned long) queued[mode][0], (unsigned long) queued[mode][1]);
+        _show_report_line(line);
     }
+}
+#endif /* LCD_BENCHMARK */
 
-    LCD_Clear(BLACK);
-    LCD_ShowString(0, 0, (const u8 *) line_message, WHITE);
+#ifdef DEBUG_REPORTS
+/**
+ * @brief      Shows the next report every DEBUG_REPORT_PERIOD_S and gives the
+ *             screen back to the status display DEBUG_REPORT_SHOW_S later.
+ *             Call once per second from the main loop.
+ * @return     Non-zero while a report is on the screen.
+ */
+int debug_report_tick(void) {
+    static void (*const reports[])(void) = {
+#ifdef PROFILE
+        debug_profile_report,
+#endif
+        debug_power_report,
+#ifdef ECLICW_STATS
+        debug_irq_report,
+#endif
+#ifdef RAMFUNC_BENCHMARK
+        debug_ramfunc_benchmark,
+#endif
+#ifdef MEM_BENCHMARK
+        debug_mem_benchmark,
+#endif
+#ifdef LCD_BENCHMARK
+        debug_lcd_benchmark,
+#endif
+    };
+    static unsigned int seconds = DEBUG_REPORT_SHOW_S, next;
+
+    if (!LCD_Ready())
+        return 0;
+    if (++seconds == DEBUG_REPORT_PERIOD_S) {
+        seconds = 0;
+        status_display_suspend();
+        (*reports[next])();
+        next = (next + 1) % (sizeof reports / sizeof reports[0]);
+        profile_reset();
+        power_stats_reset();
+        eclicw_stats_reset();
+    } else if (seconds == DEBUG_REPORT_SHOW_S) {
+        status_display_redraw();
+    }
+    return seconds < DEBUG_REPORT_SHOW_S;
 }
+#endif /* DEBUG_REPORTS */
 #endif /* DEBUG */
\ No newline at end of file
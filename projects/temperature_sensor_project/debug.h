@@ -11,15 +11,47 @@
 
 #include "string.h"
 #include "lcd.h"
+#include "profile.h"
+#include "power.h"
+#include "ramfunc.h"
+#include "mem.h"
+#include "eclicw.h"
 
 /**
  * @brief If defined, enables debugging.
  */
 #define DEBUG
 
+/**
+ * @brief If defined, the main loop shows the debug reports in turn instead of
+ *        the status screen, one every DEBUG_REPORT_PERIOD_S for
+ *        DEBUG_REPORT_SHOW_S. The profiler, the power and the interrupt
+ *        statistics are cleared after each, so a report covers one period.
+ */
+//#define DEBUG_REPORTS
+#define DEBUG_REPORT_PERIOD_S   60
+#define DEBUG_REPORT_SHOW_S     5
+
 #ifdef DEBUG
-void debug_error_message(const char *file_name, int file_line, char *message);
-void debug_error_message_custom(char *message);
+#ifdef PROFILE
+void debug_profile_report(void);
+#endif /* PROFILE */
+void debug_power_report(void);
+#ifdef ECLICW_STATS
+void debug_irq_report(void);
+#endif /* ECLICW_STATS */
+#ifdef RAMFUNC_BENCHMARK
+void debug_ramfunc_benchmark(void);
+#endif /* RAMFUNC_BENCHMARK */
+#ifdef MEM_BENCHMARK
+void debug_mem_benchmark(void);
+#endif /* MEM_BENCHMARK */
+#ifdef LCD_BENCHMARK
+void debug_lcd_benchmark(void);
+#endif /* LCD_BENCHMARK */
+#ifdef DEBUG_REPORTS
+int debug_report_tick(void);
+#endif /* DEBUG_REPORTS */
 #endif /* DEBUG */
 
 #endif /* DEBUG_H */
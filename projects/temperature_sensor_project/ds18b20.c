@@ -1,45 +1,76 @@
 #include "gd32vf103.h"
 #include "ds18b20.h"
 #include "eclicw.h"
+#include "ramfunc.h"
+#include "clock.h"
 #define Z (1<<31)
-#define U 27
-#define W1L 2*U
-#define W1H Z+93*U
-#define W0L 65*U
-#define W0H Z+30*U
-#define RL 2*U
-#define RD Z+10*U
+#define W1L 2
+#define W1H Z+93
+#define W0L 65
+#define W0H Z+30
+#define RL 2
+#define RD Z+10
 #define RS Z
-#define RW 83*U
-#define RC Z+100000*U
+#define RW 83
+#define RC Z+100000
 
 unsigned int temp=0;
-unsigned int ds18B20cmd[]=                                                          // LSB first!
-   {500*U, Z+500*U,                                                                 // Reset
+unsigned int ds18B20cmd[]=                                                          // LSB first, delays in us!
+   {500, Z+500,                                                                     // Reset
     W0L, W0H, W0L, W0H, W1L, W1H, W1L, W1H, W0L, W0H, W0L, W0H, W1L, W1H, W1L, W1H, // Skip ROM 0xCC
     W0L, W0H, W0L, W0H, W1L, W1H, W0L, W0H, W0L, W0H, W0L, W0H, W1L, W1H, W0L, W0H, // Convert  0x44
     RC, RL, RD, RS,                                                                 // Wait 100ms, done?
-    500*U, Z+500*U,                                                                 // Reset
+    500, Z+500,                                                                     // Reset
     W0L, W0H, W0L, W0H, W1L, W1H, W1L, W1H, W0L, W0H, W0L, W0H, W1L, W1H, W1L, W1H, // Skip ROM 0xCC
     W0L, W0H, W1L, W1H, W1L, W1H, W1L, W1H, W1L, W1H, W1L, W1H, W0L, W0H, W1L, W1H, // Read SP  0xBE  
     RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, // Read 1:st byte
     RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, RL,RD,RS, // Read 2:nd byte
     0};
 void (*pCB)(unsigned int tmp)=NULL;
+#define MTIME    ( *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIME ) )
+#define MTIMECMP ( *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) )
+static unsigned int d=1000000;                                                      // Current delay (us)
+static unsigned int u=27;                                                           // mtime ticks per us, core/4
+static volatile unsigned int ms=0, ticks=0;                                         // Time since init
+
+// A clock switch stops the core for up to CLOCK_SWITCH_US, only allow it in a long wait.
+static int ds18B20clockReady(void){
+   uint32_t left = (uint32_t)MTIMECMP - (uint32_t)MTIME;                            // mtime restarts at every step
+   return (int32_t)left > (int32_t)(CLOCK_SWITCH_US * u);
+}
+
+// mtime runs at core/4, rescale the step in progress to the new clock.
+static void ds18B20clockChanged(uint32_t old_hz, uint32_t new_hz){
+   uint64_t now = MTIME;
+   MTIMECMP = now + (MTIMECMP - now) * new_hz / old_hz;
+   u = new_hz / 4000000;
+}
+
+static const clock_client_t clock_client = { ds18B20clockReady, ds18B20clockChanged };
 
 void ds18B20init(void (*pISR)(unsigned int tmp)){
    pCB=pISR;
+   clock_register(&clock_client);
    eclicw_enable(CLIC_INT_TMR, 1, 1, &ds18B20fsm);
    //Turn on GPIOB if neede!
    gpio_init(GPIOB, GPIO_MODE_OUT_OD, GPIO_OSPEED_50MHZ, GPIO_PIN_5);
    gpio_bit_write(GPIOB, GPIO_PIN_5, 1);
    //Start the first conversion after a 1s shake-down...
     *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIME ) = 0;
-    *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) = 1000000*27;
+    *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) = d*u;
+}
+
+// mtime is restarted at every step, so time is kept by adding up the delays.
+unsigned int ds18B20ms(void){
+    return ms;
 }
 
-void ds18B20fsm(void){
-    static unsigned int s=0,t=0, d=0;
+// Runs from SRAM on every 1-Wire step, the pin is driven through the registers.
+RAMFUNC void ds18B20fsm(void){
+    static unsigned int s=0,t=0;
+
+    ticks+=d;                                           // The delay that just expired
+    if (ticks>=1000) {ms+=ticks/1000; ticks%=1000;}
 
     if (!ds18B20cmd[s]) {
       (*pCB)(t);s=0;t=0;
@@ -47,23 +78,23 @@ void ds18B20fsm(void){
 
     if (!(ds18B20cmd[s]<<1)) {
       if (s==37) {
-        if (gpio_input_bit_get(GPIOB, GPIO_PIN_5)) {
-          d=15*U;
+        if (GPIO_ISTAT(GPIOB) & GPIO_PIN_5) {
+          d=15;
         } else {
-          d=100000*U; s=34;
+          d=100000; s=34;
         }
       } else {
          t>>=1;
-         t+=(gpio_input_bit_get(GPIOB, GPIO_PIN_5)<<15);
+         t+=(GPIO_ISTAT(GPIOB) & GPIO_PIN_5)<<(15-5);        // PB5 to bit 15
          d=RW;
       }
     } else {
       d=ds18B20cmd[s]&0xFFFFFFF;
     }
 
-    gpio_bit_write(GPIOB, GPIO_PIN_5, ds18B20cmd[s++]>>31);
+    GPIO_BOP(GPIOB) = ds18B20cmd[s++]&Z ? GPIO_PIN_5 : GPIO_PIN_5<<16;  // Set or reset PB5
     // Be aware of possible spirous int updating mtimecmp...
     // LSW = -1; MSW = update; LSW = update, in this case safe.
     *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIME ) = 0;
-    *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) = d;
+    *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) = d*u;
 }
\ No newline at end of file
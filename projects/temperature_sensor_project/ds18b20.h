@@ -1,2 +1,3 @@
 void ds18B20init(void (*pISR)(unsigned int tmp));
-void ds18B20fsm(void);
\ No newline at end of file
+void ds18B20fsm(void);
+unsigned int ds18B20ms(void);
\ No newline at end of file
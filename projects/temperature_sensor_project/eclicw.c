@@ -1,36 +1,92 @@
 #include "eclicw.h"
 #include "gd32vf103.h"
+#include "riscv_encoding.h"
+#include "trace.h"
+#include "ramfunc.h"
 
-static void (*pmtisr)(void)=NULL;
-static void (*pu0tbeisr)(void)=NULL;
+// All sources are vectored to eclicw_dispatch through a vector table in RAM,
+// which finds the call-back from the interrupt id in mcause. The table must be
+// aligned to the next power of two above its size (87 * 4 bytes).
+static void (*vectors[ECLIC_NUM_INTERRUPTS])(void) __attribute__( ( aligned( 512 ) ) );
+static void (*isr[ECLIC_NUM_INTERRUPTS])(void);
+static uint32_t untraced[( ECLIC_NUM_INTERRUPTS + 31 ) / 32];   // Sources left out of the trace
+
+#ifdef ECLICW_STATS
+static eclicw_stats_t stats[ECLIC_NUM_INTERRUPTS];
+#endif
+
+__attribute__( ( interrupt ) ) RAMFUNC        // Entered on every interrupt, keep it off the flash
+static void eclicw_dispatch( void ) {           // c-wrapper saves environment...
+   uint32_t irqn = read_csr( mcause ) & 0xFFF;  // ...Find the int...
+#ifdef ECLICW_STATS
+   uint32_t start = read_csr( mcycle ), cycles;
+   eclicw_stats_t *s = &stats[irqn];
+   if (irqn == CLIC_INT_TMR) {                  // Compare time known, mtime runs at core/4
+       uint32_t late = ( *( volatile uint32_t * )( TIMER_CTRL_ADDR + TIMER_MTIME )
+                       - *( volatile uint32_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) ) * 4;
+       if (late > s->latency_max) s->latency_max = late;
+   }
+#endif
+#ifdef TRACE
+   int traced = !( untraced[irqn >> 5] & ( 1UL << ( irqn & 31 ) ) );
+   if (traced) TRACE_BEGIN( TRACE_IRQ, irqn );
+#endif
+   if (isr[irqn]) (*isr[irqn])();               // ...Call int's ISR...
+#ifdef TRACE
+   if (traced) TRACE_END( TRACE_IRQ, irqn );
+#endif
+#ifdef ECLICW_STATS
+   cycles = read_csr( mcycle ) - start;
+   s->count++;
+   s->cycles_total += cycles;
+   if (cycles > s->cycles_max) s->cycles_max = cycles;
+#endif
+}                                               // and restores environment (also (G)IE)!
 
 void eclicw_enable(int irqn, int level, int priority, void (*pISR)(void)){
    static uint32_t max_irqn=0;
    if (!max_irqn) {                             // Init Int vector table if not done!
+        int i;
         max_irqn = *( volatile uint32_t * )( ECLIC_ADDR_BASE + ECLIC_INFO_OFFSET );
         max_irqn &= ( 0x00001FFF );
         eclic_init( max_irqn );
         eclic_mode_enable();
+        for (i = 0; i < ECLIC_NUM_INTERRUPTS; i++) vectors[i] = eclicw_dispatch;
+        write_csr( CSR_MTVT, vectors );
+#ifdef ECLICW_STATS
+        clear_csr( CSR_MCOUNTINHIBIT, 0x1 );    // CY, whatever the startup code left
+#endif
     }
-    
+   if (irqn < 0 || irqn >= ECLIC_NUM_INTERRUPTS) return;
+
+   isr[irqn] = pISR;                            // Save call-back to int's ISR.
    eclic_set_vmode( irqn );                     // Manage the int through the vector table.
-   eclic_enable_interrupt( irqn );              // Enable the selected interrupt...
-   eclic_set_irq_lvl_abs( irqn, level );        // ...with selected level and...
-   eclic_set_irq_priority( irqn, priority );    // ...selected priorit!
+   eclic_set_irq_lvl_abs( irqn, level );        // Selected level and...
+   eclic_set_irq_priority( irqn, priority );    // ...selected priority...
+   eclic_enable_interrupt( irqn );              // ...before enabling the interrupt!
+}
 
-   switch (irqn) {
-       case CLIC_INT_TMR : pmtisr=pISR;         // Save call-back to int's ISR.
-       case USART0_IRQn  : pu0tbeisr=pISR;
-   }
+void eclicw_disable(int irqn){
+   if (irqn < 0 || irqn >= ECLIC_NUM_INTERRUPTS) return;
+   eclic_disable_interrupt( irqn );
 }
 
-__attribute__( ( interrupt ) )
-void eclic_mtip_handler( void ) {               // c-wrapper saves environment...
-  (*pmtisr)();                                  // ...Call int's ISR...
-}                                               // and restores environment (also (G)IE)!
+void eclicw_trace(int irqn, int on){            // Record the int's handler in the trace?
+   if (irqn < 0 || irqn >= ECLIC_NUM_INTERRUPTS) return;
+   if (on) untraced[irqn >> 5] &= ~( 1UL << ( irqn & 31 ) );
+   else    untraced[irqn >> 5] |= 1UL << ( irqn & 31 );
+}
 
-__attribute__( ( interrupt ) )                  // !!! ALL USART0 INT GOES HERE !!!
-void USART0_IRQHandler( void ) {                // c-wrapper saves environment...
-  (*pu0tbeisr)();                               // ...Call int's ISR...
-}                                               // and restores environment (also (G)IE)!
+const eclicw_stats_t *eclicw_stats(int irqn){   // NULL unless built with ECLICW_STATS
+#ifdef ECLICW_STATS
+   if (irqn >= 0 && irqn < ECLIC_NUM_INTERRUPTS) return &stats[irqn];
+#endif
+   return NULL;
+}
 
+void eclicw_stats_reset(void){
+#ifdef ECLICW_STATS
+   int i;
+   for (i = 0; i < ECLIC_NUM_INTERRUPTS; i++) stats[i] = ( eclicw_stats_t ){ 0 };
+#endif
+}
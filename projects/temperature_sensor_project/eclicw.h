@@ -1 +1,21 @@
+#ifndef ECLICW_H
+#define ECLICW_H
+
+#include "stdint.h"
+
+//#define ECLICW_STATS                          // Uncomment to time every interrupt with mcycle
+
+typedef struct {
+   uint32_t count;                              // Interrupts served
+   uint32_t latency_max;                        // Trigger to dispatch, cycles (mtime compare only)
+   uint32_t cycles_max;                         // Longest handler run, cycles
+   uint64_t cycles_total;                       // All handler runs, cycles
+} eclicw_stats_t;
+
 void eclicw_enable(int irqn, int level, int priority, void (*pISR)(void));
+void eclicw_disable(int irqn);
+void eclicw_trace(int irqn, int on);
+const eclicw_stats_t *eclicw_stats(int irqn);
+void eclicw_stats_reset(void);
+
+#endif /* ECLICW_H */
@@ -4,6 +4,9 @@
 
 #include "lcd.h"
 #include "oledfont.h"
+#include "temp_fixed.h"
+#include "lcd_dma.h"
+#include "riscv_encoding.h"
 
 u16 BACK_COLOR;	// Background color
 
@@ -16,6 +19,27 @@ typedef struct{
 
 lcd_config_t lcd_conf = {0};
 
+#define GLYPH_CACHE_SIZE 8          // 256 bytes each
+
+typedef struct{
+	u8 ch;                          // Character + 1, 0 = empty
+	u16 fg;
+	u16 bg;
+	u32 used;                       // Last use, for LRU replacement
+	u32 mark;                       // lcd_dma_mark() after the glyph was last queued
+	uint16_t pixels[8*16];
+}glyph_cache_t;
+
+glyph_cache_t glyph_cache[GLYPH_CACHE_SIZE];
+u32 glyph_clock=0;
+
+enum{LCD_INIT_IDLE, LCD_INIT_SEND, LCD_INIT_FLUSH, LCD_INIT_DELAYING};
+
+u8 lcd_init_state=LCD_INIT_IDLE;
+u16 lcd_init_pos;
+u32 lcd_init_start;
+u32 lcd_init_cycles;
+
 
 void lcd_delay_1ms(uint32_t count)
 {
@@ -29,34 +53,37 @@ void lcd_delay_1ms(uint32_t count)
 
 	do {
 	delta_mtime = get_timer_value() - start_mtime;
-	}while(delta_mtime <(SystemCoreClock/4000.0 *count ));
+	}while(delta_mtime <(uint64_t)SystemCoreClock/4000*count);
 }
 
 
 
-int r=0, w=0, queue[256]={0};                       // 256 Byte wr queue
-
+/*
+  Function description: block until the LCD transfer queue is empty
+  Entry data: None
+  Return value: None
+*/
 void LCD_Wait_On_Queue(){
-	while(r != w) LCD_WR_Queue();					//Blocks while emptying the queue
+	lcd_dma_flush();
 }
 
+/*
+  Function description: advance the DMA transfer engine, call from the main loop
+  Entry data: None
+  Return value: None
+*/
 void LCD_WR_Queue(){
-    if (r!=w) {                                     // Buffer empty?
-       if (spi_i2s_flag_get(SPI1,SPI_FLAG_TBE)) {   // ...no! Device redy?
-          OLED_CS_Clr();                            // ......Yes! CS (again)
-          (queue[r]>=1<<8) ? OLED_DC_Set() : OLED_DC_Clr(); //    DC
-          spi_i2s_data_transmit(SPI1, queue[r++]&0xFF); //        Write!
-          r%=256;                                   //            Advance.
-        }                                           //       (No! Return!)
-    } else {
-        OLED_CS_Set();                              // ...yes! CS high, done!
-    }
+	if(lcd_init_state!=LCD_INIT_IDLE) Lcd_Init_Poll();
+	lcd_dma_poll();
 }
 
+/*
+  Function description: queue one byte
+  Entry data: dat: byte to be written, bit 8 set for data and clear for a command
+  Return value: None
+*/
 void LCD_Write_Bus(int dat) {
-   while (((w+1)%256)==r) LCD_WR_Queue(); //If buffer full then spin...
-   queue[w++]=dat;                        //...If/when not then store data...
-   w%=256;                                //...and advance write index!
+	lcd_dma_byte((dat>>8)&1, dat&0xFF);
 }
 
 /*
@@ -87,9 +114,7 @@ void LCD_Writ_Bus(u8 dat)
 */
 void LCD_WR_DATA8(u8 dat)
 {
-	//OLED_DC_Set();  // Write data
-	//LCD_Writ_Bus(dat);
-    LCD_Write_Bus(((int)dat)+(1<<8));
+	lcd_dma_byte(OLED_DATA,dat);
 }
 
 
@@ -97,14 +122,11 @@ void LCD_WR_DATA8(u8 dat)
   Function description: LCD write 16-bit data
   Entry data: dat: 16-bit data to be written
   Return value: None
+  Note: sent as one 16-bit SPI frame, high byte first
 */
 void LCD_WR_DATA(u16 dat)
 {
-	//OLED_DC_Set();  // Write data
-	//LCD_Writ_Bus(dat>>8);
-	//LCD_Writ_Bus(dat);
-    LCD_Write_Bus(((int)dat>>8)+(1<<8));
-    LCD_Write_Bus(((int)dat&0xFF)+(1<<8));
+	lcd_dma_word(OLED_DATA,dat);
 }
 
 
@@ -115,9 +137,7 @@ void LCD_WR_DATA(u16 dat)
 */
 void LCD_WR_REG(u8 dat)
 {
-	//OLED_DC_Clr();  // Write command
-	//LCD_Writ_Bus(dat);
-    LCD_Write_Bus((int)dat);
+	lcd_dma_byte(OLED_CMD,dat);
 }
 
 
@@ -127,16 +147,16 @@ void LCD_WR_REG(u8 dat)
   Entry data: x1, x2 set the start and end column address
               y1, y2 set the start and end row address
   Return value: None
+  Note: queued as one window descriptor, see lcd_dma_window
 */
 void LCD_Address_Set(u16 x1,u16 y1,u16 x2,u16 y2)
 {
-	LCD_WR_REG(0x2a);  // Column address setting
-	LCD_WR_DATA(x1+lcd_conf.offset_x);
-	LCD_WR_DATA(x2+lcd_conf.offset_x);
-	LCD_WR_REG(0x2b);  // row address setting
-	LCD_WR_DATA(y1+lcd_conf.offset_y);
-	LCD_WR_DATA(y2+lcd_conf.offset_y);
-	LCD_WR_REG(0x2c);  // Memory write
+	if(lcd_init_state!=LCD_INIT_IDLE) Lcd_Init_Wait();
+	x1+=lcd_conf.offset_x;
+	x2+=lcd_conf.offset_x;
+	y1+=lcd_conf.offset_y;
+	y2+=lcd_conf.offset_y;
+	lcd_dma_window(x1,y1,x2,y2);  // Column, row address setting and memory write
 }
 
 /*!
@@ -164,8 +184,51 @@ void spi_config(void)
 
 	spi_crc_polynomial_set(SPI1,7);
 	spi_enable(SPI1);
+	lcd_dma_init();
 }
 
+/*
+  Function description: define the hardware scroll area
+  Entry data: x: first column that scrolls
+              width: number of columns that scroll
+  Return value: None
+  Note: the ST7735 scrolls along its native rows, which are the
+        display's x axis with the landscape access mode (MV) set in
+        Lcd_Init. Everything in these columns scrolls, whatever its y.
+        The frame memory has LCD_FRAME_LINES native rows, the part
+        outside the panel is counted in the fixed areas (offset_x)
+*/
+void LCD_ScrollArea(u16 x,u16 width)
+{
+	if(lcd_init_state!=LCD_INIT_IDLE) Lcd_Init_Wait();
+	u16 top=x+lcd_conf.offset_x;
+	u16 bottom=LCD_FRAME_LINES-top-width;
+	LCD_WR_REG(0x33);  // VSCRDEF
+	LCD_WR_DATA8(top>>8);
+	LCD_WR_DATA8(top);
+	LCD_WR_DATA8(width>>8);
+	LCD_WR_DATA8(width);
+	LCD_WR_DATA8(bottom>>8);
+	LCD_WR_DATA8(bottom);
+}
+
+
+/*
+  Function description: set the column shown first in the scroll area
+  Entry data: x: column, in the same coordinates as LCD_Address_Set
+  Return value: None
+  Note: LCD_ScrollTo(x of LCD_ScrollArea) shows the area unscrolled
+*/
+void LCD_ScrollTo(u16 x)
+{
+	if(lcd_init_state!=LCD_INIT_IDLE) Lcd_Init_Wait();
+	u16 line=x+lcd_conf.offset_x;
+	LCD_WR_REG(0x37);  // VSCSAD
+	LCD_WR_DATA8(line>>8);
+	LCD_WR_DATA8(line);
+}
+
+
 void Lcd_SetType(int type){
 	if(type == LCD_NORMAL){
 		lcd_conf.configured = 1;
@@ -183,9 +246,45 @@ void Lcd_SetType(int type){
 
 
 /*
-  Function description: LCD initialization function
-  Entry data: None
-  Return value: None
+  ST7735 power-up sequence, run by Lcd_Init_Poll:
+  command, number of parameters (| LCD_INIT_DELAY),
+  parameters, [delay in ms before the next command]
+*/
+#define LCD_INIT_DELAY 0x80
+
+const u8 lcd_init_table[]={
+	0x00, LCD_INIT_DELAY, 100,              // NOP, let the supply settle
+	0x01, LCD_INIT_DELAY, 120,              // SW reset
+	0x11, LCD_INIT_DELAY, 100,              // SLPOUT
+	0x21, 0,                                // INVON, 0x22 when inverted
+	0xB1, 3, 0x05, 0x3A, 0x3A,              // FRMCTRL1 - Full color, 67.9fps
+	0xB2, 3, 0x05, 0x3A, 0x3A,              // FRMCTRL2 - 8-bit color, 67.9fps
+	0xB3, 6, 0x05, 0x3A, 0x3A, 0x05, 0x3A, 0x3A, // Partial mode
+	0xB4, 1, 0x03,                          // INVCTR - Line inversion | Frame inversion
+	0xC0, 3, 0x62, 0x02, 0x04,              // PWRCTR1 - Set GVDD voltage
+	0xC1, 1, 0xC0,                          // More power regulation
+	0xC2, 2, 0x0D, 0x00,
+	0xC3, 2, 0x8D, 0x6A,
+	0xC4, 2, 0x8D, 0xEE,
+	0xC5, 1, 0x0E,                          // VCOM
+	0xE0, 16, 0x10, 0x0E, 0x02, 0x03, 0x0E, 0x07, 0x02, 0x07, // Gamma correction
+	          0x0A, 0x12, 0x27, 0x37, 0x00, 0x0D, 0x0E, 0x10,
+	0xE1, 16, 0x10, 0x0E, 0x03, 0x03, 0x0F, 0x06, 0x02, 0x08,
+	          0x0A, 0x13, 0x26, 0x36, 0x00, 0x0D, 0x0E, 0x10,
+	0x3A, 1, 0x05,                          // Set color resolution, 16 bit color
+	0x36, 1, 0x78,                          // Data access mode
+};
+
+
+
+/*
+  Function description: LCD initialization function
+  Entry data: None
+  Return value: None
+  Note: only starts the power-up sequence, which then runs from
+        LCD_WR_Queue (Lcd_Init_Poll) so the rest of the system can
+        start meanwhile. Drawing before LCD_Ready() returns 1 waits
+        for the sequence to finish
 */
 void Lcd_Init(void)
 {
@@ -202,109 +301,84 @@ void Lcd_Init(void)
 	spi_config();
 
 	gpio_bit_reset(GPIOC, GPIO_PIN_13 | GPIO_PIN_15);
-	LCD_Wait_On_Queue();
-	lcd_delay_1ms(100);
-	
+	lcd_init_pos=0;
+	lcd_init_state=LCD_INIT_SEND;
+	Lcd_Init_Poll();
+}
 
-	LCD_WR_REG(0x01); 	//SW reset
-	LCD_Wait_On_Queue();
-	lcd_delay_1ms(120);
-	
 
-	LCD_WR_REG(0x11); 	//SLPOUT
-	LCD_Wait_On_Queue();
-	lcd_delay_1ms(100);
-
-	if(lcd_conf.inverted) LCD_WR_REG(0x22); 
-	else				  LCD_WR_REG(0x21); 	//INVON
-
-	LCD_WR_REG(0xB1); 	//FRMCTRL1 - Full color
-	LCD_WR_DATA8(0x05); // Framerate = 333khz / (25) * (196) = 67.9fps
-	LCD_WR_DATA8(0x3A);
-	LCD_WR_DATA8(0x3A);
-
-	LCD_WR_REG(0xB2);	//FRMCTRL - 8-bit color
-	LCD_WR_DATA8(0x05); //fps = 67.9
-	LCD_WR_DATA8(0x3A);
-	LCD_WR_DATA8(0x3A);
-
-	LCD_WR_REG(0xB3);   //Partial mode
-	LCD_WR_DATA8(0x05);  
-	LCD_WR_DATA8(0x3A);
-	LCD_WR_DATA8(0x3A);
-	LCD_WR_DATA8(0x05);
-	LCD_WR_DATA8(0x3A);
-	LCD_WR_DATA8(0x3A);
-
-	LCD_WR_REG(0xB4);  //INVCTR - Inversion control
-	LCD_WR_DATA8(0x03);//Line inversion(full color) | Frame inversion
-
-	LCD_WR_REG(0xC0);  //PWRCTR1 - Set GVDD voltage
-	LCD_WR_DATA8(0x62);//
-	LCD_WR_DATA8(0x02);//
-	LCD_WR_DATA8(0x04);//
-
-	LCD_WR_REG(0xC1); //More power regulation
-	LCD_WR_DATA8(0xC0);
-
-	LCD_WR_REG(0xC2); //Same
-	LCD_WR_DATA8(0x0D);
-	LCD_WR_DATA8(0x00);
-
-	LCD_WR_REG(0xC3); //same
-	LCD_WR_DATA8(0x8D);
-	LCD_WR_DATA8(0x6A);   
-
-	LCD_WR_REG(0xC4);
-	LCD_WR_DATA8(0x8D); 
-	LCD_WR_DATA8(0xEE); 
-
-	LCD_WR_REG(0xC5);  /*VCOM*/
-	LCD_WR_DATA8(0x0E);    
-
-	LCD_WR_REG(0xE0);  //Gamma correction
-	LCD_WR_DATA8(0x10);
-	LCD_WR_DATA8(0x0E);
-	LCD_WR_DATA8(0x02);
-	LCD_WR_DATA8(0x03);
-	LCD_WR_DATA8(0x0E);
-	LCD_WR_DATA8(0x07);
-	LCD_WR_DATA8(0x02);
-	LCD_WR_DATA8(0x07);
-	LCD_WR_DATA8(0x0A);
-	LCD_WR_DATA8(0x12);
-	LCD_WR_DATA8(0x27);
-	LCD_WR_DATA8(0x37);
-	LCD_WR_DATA8(0x00);
-	LCD_WR_DATA8(0x0D);
-	LCD_WR_DATA8(0x0E);
-	LCD_WR_DATA8(0x10);
-
-	LCD_WR_REG(0xE1);
-	LCD_WR_DATA8(0x10);
-	LCD_WR_DATA8(0x0E);
-	LCD_WR_DATA8(0x03);
-	LCD_WR_DATA8(0x03);
-	LCD_WR_DATA8(0x0F);
-	LCD_WR_DATA8(0x06);
-	LCD_WR_DATA8(0x02);
-	LCD_WR_DATA8(0x08);
-	LCD_WR_DATA8(0x0A);
-	LCD_WR_DATA8(0x13);
-	LCD_WR_DATA8(0x26);
-	LCD_WR_DATA8(0x36);
-	LCD_WR_DATA8(0x00);
-	LCD_WR_DATA8(0x0D);
-	LCD_WR_DATA8(0x0E);
-	LCD_WR_DATA8(0x10);
-
-	LCD_WR_REG(0x3A);  //Set color resolution
-	LCD_WR_DATA8(0x05);//16 bit color
-
-	LCD_WR_REG(0x36); //Data access mode
-	LCD_WR_DATA8(0x78);
-	LCD_WR_REG(0x29); 
-} 
+/*
+  Function description: advance the power-up sequence
+  Entry data: None
+  Return value: None
+  Note: queues commands up to the next delay. A delay starts once
+        its command has left the SPI and is timed with mcycle, since
+        mtime is reset by the sensor. The last step clears the
+        screen to BACK_COLOR and turns the display on
+*/
+void Lcd_Init_Poll(void)
+{
+	u8 cmd,count,i;
+	for(;;)
+	{
+		switch(lcd_init_state)
+		{
+		case LCD_INIT_DELAYING:
+			if((u32)read_csr(mcycle)-lcd_init_start<lcd_init_cycles) return;
+			lcd_init_state=LCD_INIT_SEND;
+			break;
+		case LCD_INIT_FLUSH:
+			lcd_dma_poll();
+			if(lcd_dma_busy()) return;
+			lcd_init_start=read_csr(mcycle);
+			lcd_init_state=LCD_INIT_DELAYING;
+			break;
+		case LCD_INIT_SEND:
+			if(lcd_init_pos>=sizeof(lcd_init_table))
+			{
+				lcd_init_state=LCD_INIT_IDLE;
+				LCD_Clear(BACK_COLOR);
+				LCD_WR_REG(0x29);   // DISPON
+				return;
+			}
+			cmd=lcd_init_table[lcd_init_pos++];
+			count=lcd_init_table[lcd_init_pos++];
+			if(cmd==0x21 && lcd_conf.inverted) cmd=0x22;
+			LCD_WR_REG(cmd);
+			for(i=0;i<(count&~LCD_INIT_DELAY);i++) LCD_WR_DATA8(lcd_init_table[lcd_init_pos++]);
+			if(count&LCD_INIT_DELAY)
+			{
+				lcd_init_cycles=lcd_init_table[lcd_init_pos++]*(SystemCoreClock/1000);
+				lcd_init_state=LCD_INIT_FLUSH;
+			}
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+
+/*
+  Function description: check if the power-up sequence has finished
+  Entry data: None
+  Return value: 1 when the display accepts drawing, else 0
+*/
+int LCD_Ready(void)
+{
+	return lcd_init_state==LCD_INIT_IDLE;
+}
+
+
+/*
+  Function description: block until the power-up sequence has finished
+  Entry data: None
+  Return value: None
+*/
+void Lcd_Init_Wait(void)
+{
+	while(lcd_init_state!=LCD_INIT_IDLE) Lcd_Init_Poll();
+}
 
 
 /*
@@ -314,15 +388,7 @@ void Lcd_Init(void)
 */
 void LCD_Clear(u16 Color)
 {
-	u16 i,j;  	
-	LCD_Address_Set(0,0,LCD_W-1,LCD_H-1);
-    for(i=0;i<LCD_W;i++)
-	  {
-			for (j=0;j<LCD_H;j++)
-				{
-					LCD_WR_DATA(Color);
-				}
-	  }
+	LCD_Fill(0,0,LCD_W-1,LCD_H-1,Color);
 }
 
 
@@ -387,15 +453,12 @@ void LCD_DrawPoint_big(u16 x,u16 y,u16 color)
   Entry data: xsta, ysta:  start coordinates
               xend, yend:  end coordinates
   Return value: None
+  Note: the color is streamed by DMA from a single location
 */
 void LCD_Fill(u16 xsta,u16 ysta,u16 xend,u16 yend,u16 color)
 {          
-	u16 i,j; 
 	LCD_Address_Set(xsta,ysta,xend,yend);          //Set cursor position
-	for(i=ysta;i<=yend;i++)
-	{													   	 	
-		for(j=xsta;j<=xend;j++)LCD_WR_DATA(color); //Set cursor position
-	} 					  	    
+	lcd_dma_repeat(OLED_DATA,color,(xend-xsta+1)*(yend-ysta+1));
 }
 
 
@@ -486,48 +549,84 @@ void Draw_Circle(u16 x0,u16 y0,u8 r,u16 color)
 }
 
 
+/*
+  Function description: find or expand a glyph in the glyph cache
+  Entry data: num: font offset of the character (character - ' ')
+              fg, bg: foreground and background colors
+  Return value: the cache entry holding the expanded glyph
+  Note: the least recently used entry is replaced, once the DMA
+        has finished reading it
+*/
+glyph_cache_t *LCD_GetGlyph(u8 num,u16 fg,u16 bg)
+{
+	glyph_cache_t *glyph=&glyph_cache[0];
+	u8 i,pos,t,temp;
+	uint16_t *out;
+	for(i=0;i<GLYPH_CACHE_SIZE;i++)
+	{
+		if(glyph_cache[i].ch==num+1 && glyph_cache[i].fg==fg && glyph_cache[i].bg==bg)
+		{
+			glyph_cache[i].used=++glyph_clock;  // Hit
+			return &glyph_cache[i];
+		}
+		if(glyph_cache[i].used<glyph->used) glyph=&glyph_cache[i];
+	}
+	lcd_dma_wait(glyph->mark);          // Miss, the victim may still be queued
+	out=glyph->pixels;
+	for(pos=0;pos<16;pos++)
+	{
+		temp=asc2_1608[(u16)num*16+pos];
+		for(t=0;t<8;t++)
+		{
+			*out++=(temp&0x01)?fg:bg;
+			temp>>=1;
+		}
+	}
+	glyph->ch=num+1;
+	glyph->fg=fg;
+	glyph->bg=bg;
+	glyph->used=++glyph_clock;
+	return glyph;
+}
+
+
 /*
   Function description: display characters
-  Entry data: x, y:  start point coordinates
-               num:  characters to display
-              mode:  1: transparent mode
+  Entry data: x, y:  start point coordinates
+               num:  characters to display
+              mode:  1: transparent mode
                      0: non-transparent mode
-  Return value: None
+  Return value: None
+  Note: opaque glyphs are sent as one burst from the glyph cache,
+        transparent glyphs as one filled window per horizontal run
+        (consecutive rows with the same bits share the window)
 */
 void LCD_ShowChar(u16 x,u16 y,u8 num,u8 mode,u16 color)
 {
     u8 temp;
-    u8 pos,t;
-	  u16 x0=x;    
+    u8 pos,end,t,run;
+	glyph_cache_t *glyph;
     if(x>LCD_W-8 || y>LCD_H-16)return;	// Outside of display area
 	num=num-' ';                        // Get offset value
-	LCD_Address_Set(x,y,x+8-1,y+16-1);  // Set cursor position
 	if(!mode)
 	{
 		// non-trasparent mode
-		for(pos=0;pos<16;pos++)
-		{ 
-			temp=asc2_1608[(u16)num*16+pos];  // load 1608 font character
-			for(t=0;t<8;t++)
-		    {                 
-		        if(temp&0x01)LCD_WR_DATA(color);
-				else LCD_WR_DATA(BACK_COLOR);
-				temp>>=1;
-				x++;
-		    }
-			x=x0;
-			y++;
-		}	
+		glyph=LCD_GetGlyph(num,color,BACK_COLOR);
+		LCD_Address_Set(x,y,x+8-1,y+16-1);  // Set cursor position
+		lcd_dma_buffer16(OLED_DATA,glyph->pixels,8*16);
+		glyph->mark=lcd_dma_mark();
 	}else
 	{
 		// Transparent mode
-		for(pos=0;pos<16;pos++)
+		for(pos=0;pos<16;pos=end)
 		{
 		    temp=asc2_1608[(u16)num*16+pos]; // load 1608 font character
-			for(t=0;t<8;t++)
-		    {                 
-		        if(temp&0x01)LCD_DrawPoint(x+t,y+pos,color); //Draw a dot
-		        temp>>=1; 
+			for(end=pos+1;end<16 && asc2_1608[(u16)num*16+end]==temp;end++);
+			for(t=0;t<8;t+=run)
+		    {
+				for(run=0;t+run<8 && ((temp>>(t+run))&0x01);run++);
+				if(run) LCD_Fill(x+t,y+pos,x+t+run-1,y+end-1,color);
+				else run=1;
 		    }
 		}
 	}   	   	 	  
@@ -648,6 +747,84 @@ void LCD_ShowNum1(u16 x,u16 y,float num,u8 len,u16 color)
 }
 
 
+/*
+  Function description: display a Q7.8 fixed-point temperature with one decimal
+  Entry data: x, y:  start point coordinates
+              temp:  temperature in 1/256 degrees (may be negative)
+  Return value: None
+  Note: the field is padded to TEMP_Q8_STRING_LENGTH-1 characters so
+        a shorter value overwrites a longer one
+*/
+void LCD_ShowTemp(u16 x,u16 y,short temp,u16 color)
+{
+	char str[TEMP_Q8_STRING_LENGTH];
+	u8 len,t;
+	len=temp_q8_format(str,temp);
+	for(t=len;t<TEMP_Q8_STRING_LENGTH-1;t++)
+	{
+		LCD_ShowChar(x+8*(t-len),y,' ',0,color);
+	}
+	LCD_ShowString(x+8*(TEMP_Q8_STRING_LENGTH-1-len),y,(const u8 *)str,color);
+}
+
+
+#ifdef LCD_BENCHMARK
+/*
+  Function description: display characters one pixel at a time, as
+                        before the glyph cache. The reference of
+                        LCD_BenchmarkText
+  Entry data: as LCD_ShowChar
+  Return value: None
+*/
+static void LCD_ShowCharPixels(u16 x,u16 y,u8 num,u8 mode,u16 color)
+{
+    u8 temp;
+    u8 pos,t;
+    if(x>LCD_W-8 || y>LCD_H-16)return;	// Outside of display area
+	num=num-' ';                        // Get offset value
+	LCD_Address_Set(x,y,x+8-1,y+16-1);  // Set cursor position
+	for(pos=0;pos<16;pos++)
+	{
+		temp=asc2_1608[(u16)num*16+pos];  // load 1608 font character
+		for(t=0;t<8;t++)
+	    {
+			if(!mode) LCD_WR_DATA((temp&0x01)?color:BACK_COLOR);
+			else if(temp&0x01) LCD_DrawPoint(x+t,y+pos,color); // Draw a dot
+			temp>>=1;
+	    }
+	}
+}
+
+
+/*
+  Function description: measure text rendering speed
+  Entry data:  mode:  1: transparent mode
+                      0: non-transparent mode
+          reference:  1: the per-pixel renderer (before)
+                      0: LCD_ShowChar (after)
+              count:  number of characters to draw
+             queued:  set to the characters per second queued by the CPU
+  Return value: characters per second including the SPI transfer
+  Note: timed with mcycle, since mtime is reset by the sensor
+*/
+u32 LCD_BenchmarkText(u8 mode,u8 reference,u32 count,u32 *queued)
+{
+	u32 start,done,i;
+	LCD_Wait_On_Queue();
+	start=read_csr(mcycle);
+	for(i=0;i<count;i++)
+	{
+		if(reference) LCD_ShowCharPixels(8*(i%20),16*((i/20)%5),'0'+i%10,mode,WHITE);
+		else LCD_ShowChar(8*(i%20),16*((i/20)%5),'0'+i%10,mode,WHITE);
+	}
+	done=read_csr(mcycle);
+	LCD_Wait_On_Queue();
+	*queued=(uint64_t)count*SystemCoreClock/(done-start);
+	return (uint64_t)count*SystemCoreClock/((u32)read_csr(mcycle)-start);
+}
+#endif
+
+
 /*
   Function description: display the image 
   Entry data: x1, y1:  start coordinates
@@ -655,17 +832,14 @@ void LCD_ShowNum1(u16 x,u16 y,float num,u8 len,u16 color)
               *image:  pointer to image buffer
   Return value: None
   Note: image buffere contains 16-bit pixel colors
-        and its size must be (x2-x1+1) * (y2-y1+1) * 2
+        and its size must be (x2-x1+1) * (y2-y1+1) * 2.
+        The image is sent by DMA in place and must not
+        change until LCD_Wait_On_Queue returns. It is
+        byte ordered, so unlike the driver's own pixel
+        data it goes out in 8-bit frames
   */
 void LCD_ShowPicture(u16 x1, u16 y1, u16 x2, u16 y2, u8 *image)
 {
-	int i;
-	int size = (x2-x1+1) * (y2-y1+1) * 2;
 	LCD_Address_Set(x1,y1,x2,y2);
-	for(i=0;i<size;i++)
-	{ 	
-		LCD_WR_DATA8(image[i]);
-	}			
+	lcd_dma_buffer(OLED_DATA,image,(x2-x1+1) * (y2-y1+1) * 2);
 }
-
-
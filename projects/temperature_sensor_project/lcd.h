@@ -11,8 +11,11 @@
 #define LCD_NORMAL    0
 #define LCD_INVERTED  1
 
+//#define LCD_BENCHMARK // Uncomment to build LCD_BenchmarkText()
+
 #define LCD_W 160
 #define LCD_H 80
+#define LCD_FRAME_LINES 162   // ST7735 frame memory rows, the display's x axis
 
 typedef unsigned char u8;
 typedef unsigned int u16;
@@ -37,6 +40,7 @@ typedef unsigned long u32;
 #define OPAQUE      0
 
 extern  u16 BACK_COLOR;   // Background color
+extern  const u8 asc2_1608[];   // 8x16 ASCII font from oledfont.h, 16 bytes per glyph
 
 void LCD_WR_Queue();
 void LCD_Wait_On_Queue();
@@ -47,7 +51,12 @@ void LCD_WR_DATA(u16 dat);
 void LCD_WR_REG(u8 dat);
 void LCD_Address_Set(u16 x1,u16 y1,u16 x2,u16 y2);
 void Lcd_SetType(int type);
+void LCD_ScrollArea(u16 x,u16 width);
+void LCD_ScrollTo(u16 x);
 void Lcd_Init(void);
+void Lcd_Init_Poll(void);
+void Lcd_Init_Wait(void);
+int LCD_Ready(void);
 void LCD_Clear(u16 Color);
 void LCD_ShowChinese(u16 x,u16 y,u8 index,u8 size,u16 color);
 void LCD_DrawPoint(u16 x,u16 y,u16 color);
@@ -61,9 +70,13 @@ void LCD_ShowString(u16 x,u16 y,const u8 *p,u16 color);
 void LCD_ShowStr(u16 x,u16 y,const u8 *p,u16 color, u8 mode);
 void LCD_ShowNum(u16 x,u16 y,u16 num,u8 len,u16 color);
 void LCD_ShowNum1(u16 x,u16 y,float num,u8 len,u16 color);
+void LCD_ShowTemp(u16 x,u16 y,short temp,u16 color);
 void LCD_ShowPicture(u16 x1, u16 y1, u16 x2, u16 y2, u8 *image);
 void LCD_ShowLogo(u16 y);
 u32 mypow(u8 m,u8 n);
+#ifdef LCD_BENCHMARK
+u32 LCD_BenchmarkText(u8 mode,u8 reference,u32 count,u32 *queued);
+#endif
 
 // Color predefines
 #define WHITE            0xFFFF
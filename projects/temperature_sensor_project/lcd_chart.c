@@ -0,0 +1,322 @@
+/**
+ * @file        lcd_chart.c
+ * @brief       Scrolling trend chart that uses the ST7735 hardware scroll.
+ * @version     0.1
+ * @date        2022-03-16
+ */
+
+#include "lcd_chart.h"
+#include "lcd_dma.h"
+
+/**
+ * @return      value rounded down (or up) to a multiple of step.
+ */
+static int32_t _floor_step(int32_t value, int32_t step)
+{
+    return (value >= 0 ? value : value - step + 1) / step * step;
+}
+
+static int32_t _ceil_step(int32_t value, int32_t step)
+{
+    return -_floor_step(-value, step);
+}
+
+/**
+ * @brief       Computes the scale for the samples on screen: whole grid steps
+ *              around them and at least CHART_MIN_SPAN.
+ */
+static void _fit(const lcd_chart_t *chart, int32_t *low, int32_t *high)
+{
+    if (chart->low > chart->high) {
+        *low = 0;
+        *high = CHART_MIN_SPAN;
+        return;
+    }
+    *low = _floor_step(chart->low, CHART_GRID_STEP);
+    *high = _ceil_step(chart->high, CHART_GRID_STEP);
+    while (*high - *low < CHART_MIN_SPAN) {
+        *high += CHART_GRID_STEP;
+        if (*high - *low < CHART_MIN_SPAN)
+            *low -= CHART_GRID_STEP;
+    }
+    if (*low < INT16_MIN + 1)
+        *low = INT16_MIN + 1;
+    if (*high > INT16_MAX)
+        *high = INT16_MAX;
+}
+
+/**
+ * @return      Non-zero if the samples on screen need a new scale.
+ */
+static int _out_of_scale(const lcd_chart_t *chart)
+{
+    int32_t low, high;
+
+    if (chart->low > chart->high)
+        return 0;
+    if (chart->low < chart->scale_low || chart->high > chart->scale_high)
+        return 1;
+    _fit(chart, &low, &high);
+    return (high - low) * 2 <= chart->scale_high - chart->scale_low;
+}
+
+/**
+ * @brief       Finds the smallest and largest sample on screen.
+ */
+static void _scan(lcd_chart_t *chart)
+{
+    int series, position;
+
+    chart->low = INT16_MAX;
+    chart->high = INT16_MIN;
+    for (series = 0; series < chart->series_count; series++) {
+        for (position = 0; position < chart->filled; position++) {
+            temp_q8_t value = chart->samples[series][position];
+            if (value == CHART_NO_SAMPLE)
+                continue;
+            if (value < chart->low)
+                chart->low = value;
+            if (value > chart->high)
+                chart->high = value;
+        }
+    }
+}
+
+/**
+ * @brief       Applies the fitted scale and works out the rows of the grid.
+ */
+static void _apply_scale(lcd_chart_t *chart)
+{
+    int32_t low, high, value;
+
+    _fit(chart, &low, &high);
+    chart->scale_low = low;
+    chart->scale_high = high;
+
+    for (value = 0; value < (int32_t) sizeof chart->grid_rows; value++)
+        chart->grid_rows[value] = 0;
+    for (value = _ceil_step(low, CHART_GRID_STEP); value <= high; value += CHART_GRID_STEP) {
+        int y = (LCD_H - 1) - ((value - low) * (LCD_H - 1) + (high - low) / 2) / (high - low);
+        chart->grid_rows[y / 8] |= 1 << (y % 8);
+    }
+}
+
+/**
+ * @return      The row of a value on the current scale.
+ */
+static int _row(const lcd_chart_t *chart, temp_q8_t value)
+{
+    int32_t span = chart->scale_high - chart->scale_low;
+    int32_t y = (LCD_H - 1) - ((value - chart->scale_low) * (LCD_H - 1) + span / 2) / span;
+
+    if (y < 0)
+        return 0;
+    if (y > LCD_H - 1)
+        return LCD_H - 1;
+    return y;
+}
+
+/**
+ * @brief       Renders one column: background, grid and, per series, a vertical
+ *              segment from the previous sample to this one.
+ */
+static void _render(const lcd_chart_t *chart, uint8_t position, uint16_t *buffer)
+{
+    uint8_t oldest = chart->filled == chart->width ? chart->head : 0;
+    int series, y;
+
+    for (y = 0; y < LCD_H; y++)
+        buffer[y] = chart->grid_rows[y / 8] & (1 << (y % 8)) ? chart->grid : chart->background;
+
+    if (position >= chart->filled)
+        return;
+
+    for (series = 0; series < chart->series_count; series++) {
+        temp_q8_t value = chart->samples[series][position];
+        int from, to;
+
+        if (value == CHART_NO_SAMPLE)
+            continue;
+        from = to = _row(chart, value);
+        if (position != oldest) {
+            temp_q8_t previous = chart->samples[series][(position + chart->width - 1) % chart->width];
+            if (previous != CHART_NO_SAMPLE)
+                from = _row(chart, previous);
+        }
+        if (from > to) {
+            y = from;
+            from = to;
+            to = y;
+        }
+        for (y = from; y <= to; y++)
+            buffer[y] = chart->colors[series];
+    }
+}
+
+/**
+ * @brief       Queues one column, rendered into the free ping-pong buffer.
+ */
+static void _draw(lcd_chart_t *chart, uint8_t position)
+{
+    uint16_t *buffer = chart->column[chart->column_next];
+    uint16_t x = chart->x + position;
+
+    lcd_dma_wait(chart->column_mark[chart->column_next]);
+    _render(chart, position, buffer);
+    LCD_Address_Set(x, 0, x, LCD_H - 1);
+    lcd_dma_buffer16(OLED_DATA, buffer, LCD_H);
+    chart->column_mark[chart->column_next] = lcd_dma_mark();
+    chart->column_next ^= 1;
+}
+
+/**
+ * @brief       Sets up a chart. Nothing is sent to the display, the scroll
+ *              area is defined and the chart drawn by the first lcd_chart_flush().
+ *
+ * @param[out]  chart: the chart to initialize.
+ * @param[in]   x: first column of the chart.
+ * @param[in]   width: number of columns, at most CHART_MAX_WIDTH.
+ * @param[in]   series_count: number of series, at most CHART_MAX_SERIES.
+ * @param[in]   colors: colour of each series.
+ * @param[in]   background: colour behind the series.
+ * @param[in]   grid: colour of the horizontal grid lines.
+ *
+ * @return      None.
+ */
+void lcd_chart_init(lcd_chart_t *chart, uint8_t x, uint8_t width, uint8_t series_count,
+                    const uint16_t *colors, uint16_t background, uint16_t grid)
+{
+    int series, position;
+
+    chart->x = x;
+    chart->width = width > CHART_MAX_WIDTH ? CHART_MAX_WIDTH : width;
+    chart->series_count = series_count > CHART_MAX_SERIES ? CHART_MAX_SERIES : series_count;
+    chart->background = background;
+    chart->grid = grid;
+    for (series = 0; series < chart->series_count; series++) {
+        chart->colors[series] = colors[series];
+        for (position = 0; position < CHART_MAX_WIDTH; position++)
+            chart->samples[series][position] = CHART_NO_SAMPLE;
+    }
+
+    chart->head = chart->filled = chart->drawn = 0;
+    chart->pushed = 0;
+    chart->rescale = 1;
+    chart->low = INT16_MAX;
+    chart->high = INT16_MIN;
+    chart->column_mark[0] = chart->column_mark[1] = lcd_dma_mark();
+    chart->column_next = 0;
+}
+
+/**
+ * @brief       Adds one sample per series as the newest column. Only updates
+ *              the chart state. Call from the main loop: _scan() and rescale
+ *              are not safe against an lcd_chart_flush() it interrupts.
+ *
+ * @param[out]  chart: the chart.
+ * @param[in]   values: one value per series, or CHART_NO_SAMPLE.
+ *
+ * @return      None.
+ */
+void lcd_chart_push(lcd_chart_t *chart, const temp_q8_t *values)
+{
+    uint8_t position = chart->head;
+    int series, evicted = 0;
+
+    for (series = 0; series < chart->series_count; series++) {
+        temp_q8_t old = chart->samples[series][position];
+        if (chart->filled == chart->width && old != CHART_NO_SAMPLE
+                && (old == chart->low || old == chart->high))
+            evicted = 1;
+        chart->samples[series][position] = values[series];
+    }
+    if (chart->filled < chart->width)
+        chart->filled++;
+
+    /* Only a rescan when the column that scrolled out held the minimum or maximum */
+    if (evicted) {
+        _scan(chart);
+    } else {
+        for (series = 0; series < chart->series_count; series++) {
+            if (values[series] == CHART_NO_SAMPLE)
+                continue;
+            if (values[series] < chart->low)
+                chart->low = values[series];
+            if (values[series] > chart->high)
+                chart->high = values[series];
+        }
+    }
+    if (_out_of_scale(chart))
+        chart->rescale = 1;
+
+    __atomic_store_n(&chart->head, (position + 1) % chart->width, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&chart->pushed, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief       Draws the columns pushed since the last call and moves the scroll
+ *              start, or redraws the whole chart after a change of scale. Call
+ *              from the main loop.
+ *
+ * @return      None.
+ */
+void lcd_chart_flush(lcd_chart_t *chart)
+{
+    uint32_t pushed = __atomic_exchange_n(&chart->pushed, 0, __ATOMIC_RELAXED);
+    uint8_t head = __atomic_load_n(&chart->head, __ATOMIC_ACQUIRE);
+
+    if (chart->rescale || pushed >= chart->width) {
+        uint8_t position;
+
+        chart->rescale = 0;
+        _apply_scale(chart);
+        LCD_ScrollArea(chart->x, chart->width);
+        for (position = 0; position < chart->width; position++)
+            _draw(chart, position);
+        chart->drawn = head;
+    } else if (chart->drawn != head) {
+        while (chart->drawn != head) {
+            _draw(chart, chart->drawn);
+            chart->drawn = (chart->drawn + 1) % chart->width;
+        }
+    } else {
+        return;
+    }
+
+    /* The oldest column goes to the left edge, the newest to the right */
+    LCD_ScrollTo(chart->x + head);
+}
+
+/**
+ * @brief       Returns the current vertical scale, e.g. for axis labels.
+ *
+ * @return      None.
+ */
+void lcd_chart_scale(const lcd_chart_t *chart, temp_q8_t *low, temp_q8_t *high)
+{
+    *low = chart->scale_low;
+    *high = chart->scale_high;
+}
+
+/**
+ * @brief       Turns the hardware scroll off again.
+ *
+ * @return      None.
+ */
+void lcd_chart_close(lcd_chart_t *chart)
+{
+    (void) chart;
+    LCD_ScrollArea(0, LCD_W);
+    LCD_ScrollTo(0);
+}
+
+/**
+ * @brief       Redraws the whole chart and turns the hardware scroll on again
+ *              on the next flush, e.g. after lcd_chart_close().
+ *
+ * @return      None.
+ */
+void lcd_chart_redraw(lcd_chart_t *chart)
+{
+    chart->rescale = 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file        lcd_chart.h
+ * @brief       Scrolling trend chart that uses the ST7735 hardware scroll
+ *              (VSCRDEF/VSCSAD). Each new sample draws one column over the
+ *              oldest one and moves the scroll start, so the picture shifts
+ *              left without being redrawn. The chart owns its columns over the
+ *              full display height; the rest of the screen stays fixed.
+ *
+ *              The vertical scale follows the samples on screen. The window
+ *              minimum and maximum are kept up to date per sample; the whole
+ *              chart is only redrawn when they leave the scale or shrink to
+ *              less than half of it.
+ * @version     0.1
+ * @date        2022-03-16
+ */
+
+#ifndef LCD_CHART_H
+#define LCD_CHART_H
+
+#include "stdint.h"
+#include "lcd.h"
+#include "temp_fixed.h"
+
+#define CHART_MAX_SERIES        3
+#define CHART_MAX_WIDTH         128
+
+/**
+ * @brief Sample value for a series without a reading (nothing is drawn).
+ */
+#define CHART_NO_SAMPLE         INT16_MIN
+
+/**
+ * @brief Smallest vertical scale and the grid spacing, in Q7.8.
+ */
+#define CHART_MIN_SPAN          TEMP_Q8_FROM_INT(2)
+#define CHART_GRID_STEP         TEMP_Q8_FROM_INT(1)
+
+typedef struct {
+    uint8_t x;                  // First column of the scroll area
+    uint8_t width;              // Columns in the scroll area
+    uint8_t series_count;
+    uint16_t background;
+    uint16_t grid;
+    uint16_t colors[CHART_MAX_SERIES];
+    temp_q8_t samples[CHART_MAX_SERIES][CHART_MAX_WIDTH];
+
+    uint8_t head;               // Column written next, the oldest one on screen
+    uint8_t filled;             // Columns holding samples
+    uint8_t drawn;              // Column drawn next by lcd_chart_flush()
+    uint32_t pushed;            // Pushes since the last flush
+    uint8_t rescale;            // The whole chart must be redrawn
+
+    temp_q8_t low;              // Smallest and largest sample on screen
+    temp_q8_t high;
+    temp_q8_t scale_low;        // Values at the bottom and top row
+    temp_q8_t scale_high;
+    uint8_t grid_rows[(LCD_H + 7) / 8];
+
+    uint16_t column[2][LCD_H];  // Ping-pong column buffers
+    uint32_t column_mark[2];
+    uint8_t column_next;
+} lcd_chart_t;
+
+void lcd_chart_init(lcd_chart_t *chart, uint8_t x, uint8_t width, uint8_t series_count,
+                    const uint16_t *colors, uint16_t background, uint16_t grid);
+void lcd_chart_push(lcd_chart_t *chart, const temp_q8_t *values);
+void lcd_chart_flush(lcd_chart_t *chart);
+void lcd_chart_scale(const lcd_chart_t *chart, temp_q8_t *low, temp_q8_t *high);
+void lcd_chart_close(lcd_chart_t *chart);
+void lcd_chart_redraw(lcd_chart_t *chart);
+
+#endif /* LCD_CHART_H */
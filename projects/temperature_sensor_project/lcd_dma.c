@@ -0,0 +1,574 @@
+/**
+ * @file        lcd_dma.c
+ * @brief       DMA driven transfer engine for the LCD on SPI1 (DMA0 channel 4).
+ * @version     0.1
+ * @date        2022-03-14
+ */
+
+#include "lcd_dma.h"
+#include "lcd.h"
+#include "gd32vf103.h"
+#include "eclicw.h"
+#include "ring.h"
+#include "ramfunc.h"
+#include "clock.h"
+
+/**
+ * @brief Descriptor flags.
+ */
+#define LCD_DMA_STAGED          0x01    // The source lives in a staging ring
+#define LCD_DMA_REPEAT          0x02    // Send the same source count times
+#define LCD_DMA_WIDE            0x04    // 16-bit frames, the source holds native uint16_t
+#define LCD_DMA_WINDOW          0x08    // Address window, sent by the CPU (no DMA)
+
+/**
+ * @brief One queued transfer.
+ */
+typedef struct {
+    union {
+        const uint8_t *source;
+        uint8_t window[4];      // x1, y1, x2, y2 of a window descriptor
+        uint16_t value;         // Sent in place by a repeat descriptor
+    };
+    uint16_t count;             // Number of DMA beats (bytes, or 16-bit frames when wide)
+    uint8_t dc;                 // OLED_CMD or OLED_DATA
+    uint8_t flags;
+} lcd_dma_desc_t;               // 8 bytes
+
+static lcd_dma_desc_t queue[LCD_DMA_QUEUE_SIZE];
+static volatile uint32_t queue_read;    // Oldest descriptor, the active one while running
+static uint32_t queue_write;            // Next free descriptor
+
+/* Staged beats are sent from the rings in place and released as their
+   descriptors retire, in queue order */
+RING_DEFINE(stage_ring, uint8_t, LCD_DMA_STAGE_SIZE)
+RING_DEFINE(stage_words_ring, uint16_t, LCD_DMA_STAGE_WORDS)
+
+static stage_ring_t stage;
+static stage_words_ring_t stage_words;
+
+static volatile uint8_t running;        // DMA is transferring queue[queue_read]
+static volatile uint8_t selected;       // CS is held low
+static uint8_t dc_level;
+static uint8_t frame_wide;      // SPI1 and the DMA use 16-bit frames
+static lcd_dma_callback_t complete_callback;
+static volatile uint8_t lock_depth;
+
+/**
+ * @brief       Keeps the transfer complete interrupt from advancing the queue
+ *              while it is being changed. Nests; the DMA keeps running and
+ *              lcd_dma_poll() still works inside. The source is masked at the
+ *              ECLIC, as u0_TX_Queue() does: the interrupt enable bit lives in
+ *              DMA_CHCTL, which the handler writes too, so a read-modify-write
+ *              of it here could restore a stale CHEN.
+ */
+static void _lock()
+{
+    if (!lock_depth++)
+        eclic_disable_interrupt(DMA0_Channel4_IRQn);
+}
+
+static void _unlock()
+{
+    if (!--lock_depth)
+        eclic_enable_interrupt(DMA0_Channel4_IRQn);
+}
+
+/**
+ * @brief       Waits until the last byte has left the shift register.
+ */
+static void _wait_idle()
+{
+    while (RESET == spi_i2s_flag_get(SPI1, SPI_FLAG_TBE));
+    while (SET == spi_i2s_flag_get(SPI1, SPI_FLAG_TRANS));
+}
+
+/**
+ * @brief       Switches SPI1 and the DMA between 8 and 16-bit frames. The frame
+ *              format may only change while SPI1 is disabled; SCK stays at its
+ *              idle level meanwhile, so CS is kept low and a memory write on
+ *              the panel carries on.
+ */
+static void _set_frame(uint8_t wide)
+{
+    spi_disable(SPI1);
+    spi_i2s_data_frame_format_config(SPI1, wide ? SPI_FRAMESIZE_16BIT : SPI_FRAMESIZE_8BIT);
+    spi_enable(SPI1);
+    dma_periph_width_config(DMA0, DMA_CH4, wide ? DMA_PERIPHERAL_WIDTH_16BIT : DMA_PERIPHERAL_WIDTH_8BIT);
+    dma_memory_width_config(DMA0, DMA_CH4, wide ? DMA_MEMORY_WIDTH_16BIT : DMA_MEMORY_WIDTH_8BIT);
+    frame_wide = wide;
+}
+
+/**
+ * @brief       Sends one byte with the CPU and waits until it has left SPI1.
+ */
+static void _send(uint8_t dc, uint8_t data)
+{
+    if (dc)
+        OLED_DC_Set();
+    else
+        OLED_DC_Clr();
+    spi_i2s_data_transmit(SPI1, data);
+    _wait_idle();
+}
+
+/**
+ * @brief       Sends a window descriptor: column and row address set followed
+ *              by memory write. The eleven bytes need four DC changes, each of
+ *              which has to wait for the SPI anyway, so they are written
+ *              directly instead of as five DMA transfers.
+ */
+static void _send_window(const lcd_dma_desc_t *desc)
+{
+    _wait_idle();
+    if (frame_wide)
+        _set_frame(0);
+    if (!selected) {
+        OLED_CS_Clr();
+        selected = 1;
+    }
+    _send(OLED_CMD, 0x2a);
+    _send(OLED_DATA, 0);
+    _send(OLED_DATA, desc->window[0]);
+    _send(OLED_DATA, 0);
+    _send(OLED_DATA, desc->window[2]);
+    _send(OLED_CMD, 0x2b);
+    _send(OLED_DATA, 0);
+    _send(OLED_DATA, desc->window[1]);
+    _send(OLED_DATA, 0);
+    _send(OLED_DATA, desc->window[3]);
+    _send(OLED_CMD, 0x2c);
+    dc_level = OLED_CMD;
+}
+
+/**
+ * @return      Non-zero if DC, the frame format or CS has to change before the
+ *              descriptor can be sent, which means waiting for the SPI.
+ */
+static inline __attribute__( ( always_inline ) ) int _needs_switch(const lcd_dma_desc_t *desc)
+{
+    return !selected || desc->dc != dc_level || ((desc->flags & LCD_DMA_WIDE) != 0) != frame_wide;
+}
+
+/**
+ * @brief       Points the DMA at a descriptor and enables it, on the registers
+ *              since the interrupt handler runs it from SRAM.
+ */
+RAMFUNC static void _start_dma(const lcd_dma_desc_t *desc)
+{
+    if (desc->flags & LCD_DMA_REPEAT) {
+        DMA_CHCTL(DMA0, DMA_CH4) &= ~DMA_CHXCTL_MNAGA;
+        DMA_CHMADDR(DMA0, DMA_CH4) = (uint32_t) &desc->value;
+    } else {
+        DMA_CHCTL(DMA0, DMA_CH4) |= DMA_CHXCTL_MNAGA;
+        DMA_CHMADDR(DMA0, DMA_CH4) = (uint32_t) desc->source;
+    }
+    DMA_CHCNT(DMA0, DMA_CH4) = desc->count;
+    DMA_CHCTL(DMA0, DMA_CH4) |= DMA_CHXCTL_CHEN;
+    running = 1;
+}
+
+/**
+ * @brief       Starts the DMA on a descriptor, switching DC and the frame
+ *              format first if needed.
+ */
+static void _start(const lcd_dma_desc_t *desc)
+{
+    uint8_t wide = (desc->flags & LCD_DMA_WIDE) != 0;
+
+    if (_needs_switch(desc)) {
+        _wait_idle();
+        if (wide != frame_wide)
+            _set_frame(wide);
+        if (desc->dc)
+            OLED_DC_Set();
+        else
+            OLED_DC_Clr();
+        dc_level = desc->dc;
+        if (!selected) {
+            OLED_CS_Clr();
+            selected = 1;
+        }
+    }
+    _start_dma(desc);
+}
+
+/**
+ * @brief       Retires the running transfer if the DMA has finished it.
+ *
+ * @return      Non-zero if a transfer was retired.
+ */
+RAMFUNC static int _retire(void)
+{
+    const lcd_dma_desc_t *desc = &queue[queue_read & LCD_DMA_QUEUE_MASK];
+
+    if (!running || !(DMA_INTF(DMA0) & DMA_FLAG_ADD(DMA_FLAG_FTF, DMA_CH4)))
+        return 0;
+    DMA_INTC(DMA0) = DMA_FLAG_ADD(DMA_FLAG_G, DMA_CH4);
+    DMA_CHCTL(DMA0, DMA_CH4) &= ~DMA_CHXCTL_CHEN;
+    if (desc->flags & LCD_DMA_STAGED) {
+        if (desc->flags & LCD_DMA_WIDE)
+            stage_words_ring_read_release(&stage_words, desc->count);
+        else
+            stage_ring_read_release(&stage, desc->count);
+    }
+    queue_read++;
+    running = 0;
+    return 1;
+}
+
+/**
+ * @brief       Transfer complete interrupt. Retires the finished transfer and
+ *              restarts the DMA on the next descriptor if it goes out as it is.
+ *              Windows, DC and frame switches, which wait for the SPI, and the
+ *              end of the chain are left to lcd_dma_poll() in the main loop;
+ *              the interrupt has woken it from sleep. Runs from SRAM.
+ */
+RAMFUNC static void _transfer_complete(void)
+{
+    const lcd_dma_desc_t *next;
+
+    if (!_retire() || queue_read == queue_write)
+        return;
+    next = &queue[queue_read & LCD_DMA_QUEUE_MASK];
+    if (!(next->flags & LCD_DMA_WINDOW) && !_needs_switch(next))
+        _start_dma(next);
+}
+
+/**
+ * @return      The last queued descriptor if it has not been started yet, else NULL.
+ */
+static lcd_dma_desc_t *_open_tail()
+{
+    uint32_t tail = queue_write - 1;
+
+    if (queue_read == queue_write || (running && tail == queue_read))
+        return 0;
+    return &queue[tail & LCD_DMA_QUEUE_MASK];
+}
+
+/**
+ * @brief       Queues a descriptor, spinning while the queue is full.
+ *
+ * @return      The new descriptor.
+ */
+static lcd_dma_desc_t *_append(uint8_t dc, const uint8_t *source, uint16_t count, uint8_t flags)
+{
+    lcd_dma_desc_t *desc;
+
+    while (queue_write - queue_read == LCD_DMA_QUEUE_SIZE)
+        lcd_dma_poll();
+
+    desc = &queue[queue_write & LCD_DMA_QUEUE_MASK];
+    desc->source = source;
+    desc->count = count;
+    desc->dc = dc;
+    desc->flags = flags;
+    queue_write++;
+    return desc;
+}
+
+/**
+ * @brief       Adds one staged beat to the last descriptor if it continues it,
+ *              otherwise queues a new descriptor for it.
+ */
+static void _merge(uint8_t dc, const uint8_t *slot, uint8_t flags)
+{
+    lcd_dma_desc_t *tail = _open_tail();
+    uint8_t size = flags & LCD_DMA_WIDE ? 2 : 1;
+
+    if (tail && tail->flags == flags && tail->dc == dc
+            && tail->source + tail->count * size == slot && tail->count < LCD_DMA_MAX_COUNT) {
+        if (++tail->count * size >= LCD_DMA_KICK_BYTES)
+            lcd_dma_poll();
+    } else {
+        _append(dc, slot, 1, flags);
+    }
+}
+
+/**
+ * @brief       The SPI clock may only change between transfers.
+ */
+static int _clock_ready(void)
+{
+    return !lcd_dma_busy();
+}
+
+/**
+ * @brief       Picks the smallest SPI1 prescaler within LCD_DMA_SPI_MAX_HZ.
+ */
+static void _clock_changed(uint32_t old_hz, uint32_t new_hz)
+{
+    uint32_t apb1 = new_hz / 2, psc = 0;
+    (void) old_hz;
+
+    while (psc < 7 && (apb1 >> (psc + 1)) > LCD_DMA_SPI_MAX_HZ)
+        psc++;
+    SPI_CTL0(SPI1) = (SPI_CTL0(SPI1) & ~SPI_CTL0_PSC) | CTL0_PSC(psc);
+}
+
+static const clock_client_t clock_client = { _clock_ready, _clock_changed };
+
+/**
+ * @brief       Sets up DMA0 channel 4 for memory to SPI1 transfers and its
+ *              transfer complete interrupt. Call after SPI1 has been configured.
+ *
+ * @return      None.
+ */
+void lcd_dma_init(void)
+{
+    dma_parameter_struct dma_init_struct;
+
+    rcu_periph_clock_enable(RCU_DMA0);
+    dma_deinit(DMA0, DMA_CH4);
+    dma_struct_para_init(&dma_init_struct);
+    dma_init_struct.periph_addr = (uint32_t) &SPI_DATA(SPI1);
+    dma_init_struct.periph_width = DMA_PERIPHERAL_WIDTH_8BIT;
+    dma_init_struct.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+    dma_init_struct.memory_width = DMA_MEMORY_WIDTH_8BIT;
+    dma_init_struct.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+    dma_init_struct.direction = DMA_MEMORY_TO_PERIPHERAL;
+    dma_init_struct.priority = DMA_PRIORITY_HIGH;
+    dma_init(DMA0, DMA_CH4, &dma_init_struct);
+    spi_dma_enable(SPI1, SPI_DMA_TRANSMIT);
+
+    queue_read = queue_write = 0;
+    stage_ring_init(&stage);
+    stage_words_ring_init(&stage_words);
+    running = selected = 0;
+    frame_wide = 0;
+    lock_depth = 0;
+
+    /* Chains the transfers once interrupts are enabled, polling does it until then */
+    dma_interrupt_enable(DMA0, DMA_CH4, DMA_INT_FTF);
+    eclicw_enable(DMA0_Channel4_IRQn, 2, 1, &_transfer_complete);
+    eclicw_trace(DMA0_Channel4_IRQn, 0);    // One per transfer, would flood the trace
+    clock_register(&clock_client);
+}
+
+/**
+ * @brief       Queues one byte. Consecutive bytes with the same DC level are
+ *              sent as one transfer.
+ *
+ * @param[in]   dc: OLED_CMD or OLED_DATA.
+ * @param[in]   data: the byte to send.
+ *
+ * @return      None.
+ */
+void lcd_dma_byte(uint8_t dc, uint8_t data)
+{
+    uint8_t *slot;
+    uint32_t free;
+
+    _lock();
+    while (!stage_ring_free(&stage))
+        lcd_dma_poll();
+
+    slot = stage_ring_write_span(&stage, &free);
+    *slot = data;
+    stage_ring_write_commit(&stage, 1);
+    _merge(dc, slot, LCD_DMA_STAGED);
+    _unlock();
+}
+
+/**
+ * @brief       Queues one 16-bit frame, e.g. an RGB565 pixel. Consecutive frames
+ *              with the same DC level are sent as one transfer.
+ *
+ * @param[in]   dc: OLED_CMD or OLED_DATA.
+ * @param[in]   data: the value to send, most significant byte first.
+ *
+ * @return      None.
+ */
+void lcd_dma_word(uint8_t dc, uint16_t data)
+{
+    uint16_t *slot;
+    uint32_t free;
+
+    _lock();
+    while (!stage_words_ring_free(&stage_words))
+        lcd_dma_poll();
+
+    slot = stage_words_ring_write_span(&stage_words, &free);
+    *slot = data;
+    stage_words_ring_write_commit(&stage_words, 1);
+    _merge(dc, (const uint8_t *) slot, LCD_DMA_STAGED | LCD_DMA_WIDE);
+    _unlock();
+}
+
+/**
+ * @brief       Queues a buffer that is sent in place, without copying.
+ *
+ * @param[in]   dc: OLED_CMD or OLED_DATA.
+ * @param[in]   data: the bytes to send. Must stay valid until lcd_dma_busy()
+ *              returns 0.
+ * @param[in]   length: number of bytes.
+ *
+ * @return      None.
+ */
+void lcd_dma_buffer(uint8_t dc, const uint8_t *data, uint32_t length)
+{
+    _lock();
+    while (length) {
+        uint16_t count = length > LCD_DMA_MAX_COUNT ? LCD_DMA_MAX_COUNT : length;
+        _append(dc, data, count, 0);
+        data += count;
+        length -= count;
+    }
+    lcd_dma_poll();
+    _unlock();
+}
+
+/**
+ * @brief       Queues 16-bit values that are sent in place as 16-bit frames,
+ *              e.g. a buffer of RGB565 pixels.
+ *
+ * @param[in]   dc: OLED_CMD or OLED_DATA.
+ * @param[in]   data: the values to send, each most significant byte first.
+ *              Must stay valid until it has been sent, see lcd_dma_mark().
+ * @param[in]   count: number of values.
+ *
+ * @return      None.
+ */
+void lcd_dma_buffer16(uint8_t dc, const uint16_t *data, uint32_t count)
+{
+    _lock();
+    while (count) {
+        uint16_t frames = count > LCD_DMA_MAX_COUNT ? LCD_DMA_MAX_COUNT : count;
+        _append(dc, (const uint8_t *) data, frames, LCD_DMA_WIDE);
+        data += frames;
+        count -= frames;
+    }
+    lcd_dma_poll();
+    _unlock();
+}
+
+/**
+ * @brief       Queues an address window (CASET, RASET and RAMWR) as a single
+ *              descriptor. Pixel data queued next is written into the window.
+ *
+ * @param[in]   x1, y1: first column and row, in panel coordinates.
+ * @param[in]   x2, y2: last column and row, in panel coordinates.
+ *
+ * @return      None.
+ */
+void lcd_dma_window(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
+{
+    lcd_dma_desc_t *desc;
+
+    _lock();
+    desc = _append(OLED_CMD, 0, 0, LCD_DMA_WINDOW);
+    desc->window[0] = x1;
+    desc->window[1] = y1;
+    desc->window[2] = x2;
+    desc->window[3] = y2;
+    _unlock();
+}
+
+/**
+ * @brief       Queues a 16-bit value sent count times from a single location
+ *              (memory increment off), e.g. an RGB565 colour for a solid fill.
+ *
+ * @param[in]   dc: OLED_CMD or OLED_DATA.
+ * @param[in]   value: the value to repeat, sent most significant byte first.
+ * @param[in]   count: number of repetitions.
+ *
+ * @return      None.
+ */
+void lcd_dma_repeat(uint8_t dc, uint16_t value, uint32_t count)
+{
+    _lock();
+    while (count) {
+        uint16_t frames = count > LCD_DMA_MAX_COUNT ? LCD_DMA_MAX_COUNT : count;
+        lcd_dma_desc_t *desc = _append(dc, 0, frames, LCD_DMA_REPEAT | LCD_DMA_WIDE);
+        desc->value = value;
+        count -= frames;
+    }
+    lcd_dma_poll();
+    _unlock();
+}
+
+/**
+ * @brief       Advances the engine: retires a finished transfer, sends window
+ *              descriptors, starts the next transfer and releases CS and calls
+ *              the completion callback when the queue has drained. Call from
+ *              the main loop, never from an interrupt: it waits for the SPI.
+ *
+ * @return      None.
+ */
+void lcd_dma_poll(void)
+{
+    _lock();
+    if (running && !_retire()) {
+        _unlock();
+        return;
+    }
+
+    /* Window descriptors are sent on the spot, then the next one is started */
+    while (queue_read != queue_write && (queue[queue_read & LCD_DMA_QUEUE_MASK].flags & LCD_DMA_WINDOW))
+        _send_window(&queue[queue_read++ & LCD_DMA_QUEUE_MASK]);
+
+    if (queue_read != queue_write) {
+        _start(&queue[queue_read & LCD_DMA_QUEUE_MASK]);
+    } else if (selected) {
+        _wait_idle();
+        OLED_CS_Set();
+        selected = 0;
+        if (complete_callback)
+            complete_callback();
+    }
+    _unlock();
+}
+
+/**
+ * @brief       Blocks until everything queued has been sent.
+ *
+ * @return      None.
+ */
+void lcd_dma_flush(void)
+{
+    while (lcd_dma_busy())
+        lcd_dma_poll();
+}
+
+/**
+ * @return      Non-zero while transfers are queued or CS is still held low.
+ */
+int lcd_dma_busy(void)
+{
+    return running || selected || queue_read != queue_write;
+}
+
+/**
+ * @return      A mark for everything queued so far, see lcd_dma_wait().
+ */
+uint32_t lcd_dma_mark(void)
+{
+    return queue_write;
+}
+
+/**
+ * @brief       Blocks until everything queued before the mark has been sent,
+ *              e.g. before a buffer given to lcd_dma_buffer() is reused.
+ *
+ * @param[in]   mark: a value returned by lcd_dma_mark().
+ *
+ * @return      None.
+ */
+void lcd_dma_wait(uint32_t mark)
+{
+    while ((int32_t) (queue_read - mark) < 0)
+        lcd_dma_poll();
+}
+
+/**
+ * @brief       Sets the function called when a chain of transfers has completed.
+ *
+ * @param[in]   callback: the function, or NULL for none.
+ *
+ * @return      None.
+ */
+void lcd_dma_set_callback(lcd_dma_callback_t callback)
+{
+    complete_callback = callback;
+}
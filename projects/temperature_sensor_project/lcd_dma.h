@@ -0,0 +1,86 @@
+/**
+ * @file        lcd_dma.h
+ * @brief       DMA driven transfer engine for the LCD on SPI1 (DMA0 channel 4).
+ *
+ *              Writes are queued as descriptors (DC level + source buffer) that
+ *              the engine chains back to back. Single bytes and 16-bit values
+ *              are copied into staging rings and merged into the last
+ *              descriptor, buffers are sent in place and solid fills repeat one
+ *              16-bit value with the DMA memory increment turned off.
+ *
+ *              Commands and their byte parameters use 8-bit SPI frames. Pixel
+ *              data (lcd_dma_word, lcd_dma_buffer16, lcd_dma_repeat) uses 16-bit
+ *              frames, which halves the DMA beats and lets pixels be stored
+ *              as native uint16_t. CS is held low for the whole chain and released
+ *              once the queue has drained, which raises the completion event.
+ *              The DMA transfer complete interrupt chains the transfers within
+ *              an item: it only restarts the DMA, and windows and DC or frame
+ *              switches, which wait for the SPI, are left to lcd_dma_poll() in
+ *              the main loop. Every tile, glyph, chart column and image chunk
+ *              starts with a window, so between items SPI1 waits for the main
+ *              loop and a redraw costs more than the longer of render and
+ *              transfer.
+ *
+ *              An address window is a single descriptor holding its four
+ *              coordinates; the engine writes its command bytes itself when
+ *              it gets to it, instead of queueing five short transfers.
+ * @version     0.1
+ * @date        2022-03-14
+ */
+
+#ifndef LCD_DMA_H
+#define LCD_DMA_H
+
+#include "stdint.h"
+
+/**
+ * @brief Number of queued descriptors (must be a power of two).
+ */
+#define LCD_DMA_QUEUE_SIZE      32
+#define LCD_DMA_QUEUE_MASK      (LCD_DMA_QUEUE_SIZE - 1)
+
+/**
+ * @brief Size of the staging rings for single byte and single 16-bit writes.
+ *        Only commands, their parameters and single pixels are staged, so
+ *        the descriptor queue and both rings take 512 bytes in all.
+ */
+#define LCD_DMA_STAGE_SIZE      128
+#define LCD_DMA_STAGE_WORDS     64
+
+/**
+ * @brief Staged bytes collected in the last descriptor before the engine is kicked.
+ */
+#define LCD_DMA_KICK_BYTES      32
+
+/**
+ * @brief Largest number of beats in one DMA descriptor (16-bit counter).
+ */
+#define LCD_DMA_MAX_COUNT       0xFFFF
+
+/**
+ * @brief Fastest SPI1 clock, what APB1 / 4 gives at 108 MHz. The prescaler is
+ *        chosen again for every core clock profile.
+ */
+#define LCD_DMA_SPI_MAX_HZ      13500000
+
+/**
+ * @brief Called from lcd_dma_poll() when a chain of transfers has completed,
+ *        in the main loop.
+ */
+typedef void (*lcd_dma_callback_t)(void);
+
+void lcd_dma_init(void);
+void lcd_dma_byte(uint8_t dc, uint8_t data);
+void lcd_dma_word(uint8_t dc, uint16_t data);
+void lcd_dma_buffer(uint8_t dc, const uint8_t *data, uint32_t length);
+void lcd_dma_buffer16(uint8_t dc, const uint16_t *data, uint32_t count);
+void lcd_dma_window(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+void lcd_dma_repeat(uint8_t dc, uint16_t value, uint32_t count);
+void lcd_dma_poll(void);
+void lcd_dma_flush(void);
+int lcd_dma_busy(void);
+uint32_t lcd_dma_mark(void);
+void lcd_dma_wait(uint32_t mark);
+void lcd_dma_set_callback(lcd_dma_callback_t callback);
+
+#endif /* LCD_DMA_H */
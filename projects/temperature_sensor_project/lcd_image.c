@@ -0,0 +1,103 @@
+/**
+ * @file        lcd_image.c
+ * @brief       Streaming decoder for run-length coded palette images. Pixels
+ *              are decoded into two small buffers that the DMA sends while the
+ *              next one is filled; long runs go out as repeat transfers without
+ *              being decoded at all.
+ * @version     0.1
+ * @date        2022-03-17
+ */
+
+#include "lcd_image.h"
+#include "lcd_dma.h"
+
+static uint16_t chunks[2][LCD_IMAGE_CHUNK];
+static uint32_t chunk_mark[2];          // lcd_dma_mark() after the buffer was queued
+static uint8_t chunk_next;
+
+/**
+ * @brief       Queues the pixels of the current buffer and switches to the
+ *              other one once the DMA has finished with it.
+ *
+ * @return      The buffer to decode into next.
+ */
+static uint16_t *_send_chunk(uint16_t *buffer, int count)
+{
+    lcd_dma_buffer16(OLED_DATA, buffer, count);
+    chunk_mark[chunk_next] = lcd_dma_mark();
+    chunk_next ^= 1;
+    lcd_dma_wait(chunk_mark[chunk_next]);
+    return chunks[chunk_next];
+}
+
+/**
+ * @brief       Draws an image with its top left corner at (x, y). The image
+ *              must fit on the screen.
+ *
+ * @param[in]   x, y: position of the top left corner.
+ * @param[in]   image: the image, usually generated by tools/img2lcd.py.
+ *
+ * @return      None.
+ */
+void lcd_image_draw(uint16_t x, uint16_t y, const lcd_image_t *image)
+{
+    const uint8_t *in = image->data;
+    const uint8_t *end = image->data + image->size;
+    uint16_t *buffer;
+    uint32_t repeat = 0;                // Pending solid run, merged across codes
+    uint16_t repeat_color = 0;
+    int fill = 0;
+
+    if (!image->width || !image->height)
+        return;
+    LCD_Address_Set(x, y, x + image->width - 1, y + image->height - 1);
+
+    /* The other buffer may still be in flight from the previous image */
+    lcd_dma_wait(chunk_mark[chunk_next]);
+    buffer = chunks[chunk_next];
+
+    while (in < end) {
+        uint8_t code = *in++;
+        uint32_t run = 1;
+        uint16_t color;
+
+        if (code & 0x80) {
+            run = (code & 0x7F) + 2;
+            if (in == end)
+                break;
+            code = *in++;
+        }
+        color = image->palette[code < image->colors ? code : 0];
+
+        if (repeat && color == repeat_color) {
+            repeat += run;
+            continue;
+        }
+        if (repeat) {
+            lcd_dma_repeat(OLED_DATA, repeat_color, repeat);
+            repeat = 0;
+        }
+        if (run >= LCD_IMAGE_REPEAT_MIN) {
+            if (fill) {
+                buffer = _send_chunk(buffer, fill);
+                fill = 0;
+            }
+            repeat = run;
+            repeat_color = color;
+            continue;
+        }
+
+        while (run--) {
+            buffer[fill++] = color;
+            if (fill == LCD_IMAGE_CHUNK) {
+                buffer = _send_chunk(buffer, fill);
+                fill = 0;
+            }
+        }
+    }
+
+    if (repeat)
+        lcd_dma_repeat(OLED_DATA, repeat_color, repeat);
+    if (fill)
+        _send_chunk(buffer, fill);
+}
@@ -0,0 +1,46 @@
+/**
+ * @file        lcd_image.h
+ * @brief       Compressed images for the LCD. Pixels are stored as indexes into
+ *              an RGB565 palette of at most 128 colours, run-length coded:
+ *
+ *                  0iiiiiii            one pixel of colour i
+ *                  1nnnnnnn iiiiiiii   n + 2 pixels (2..129) of colour i
+ *
+ *              in row order over the whole image. A full screen of flat status
+ *              graphics takes a few hundred bytes instead of 25.6 KB.
+ *              tools/img2lcd.py converts PPM/PNG files into C sources.
+ * @version     0.1
+ * @date        2022-03-17
+ */
+
+#ifndef LCD_IMAGE_H
+#define LCD_IMAGE_H
+
+#include "stdint.h"
+#include "lcd.h"
+
+#define LCD_IMAGE_MAX_COLORS    128
+#define LCD_IMAGE_MAX_RUN       129
+
+/**
+ * @brief Pixels decoded into one DMA buffer (two are used in turn).
+ */
+#define LCD_IMAGE_CHUNK         64
+
+/**
+ * @brief Runs at least this long are sent as a solid fill instead of decoded.
+ */
+#define LCD_IMAGE_REPEAT_MIN    16
+
+typedef struct {
+    uint8_t width;
+    uint8_t height;
+    uint8_t colors;             // Palette entries
+    const uint16_t *palette;    // RGB565
+    const uint8_t *data;        // Run-length coded indexes
+    uint32_t size;              // Bytes in data
+} lcd_image_t;
+
+void lcd_image_draw(uint16_t x, uint16_t y, const lcd_image_t *image);
+
+#endif /* LCD_IMAGE_H */
@@ -0,0 +1,326 @@
+/**
+ * @file        lcd_tile.c
+ * @brief       Retained-mode renderer for the 160x80 LCD with per-tile dirty
+ *              tracking. Only two tile buffers (2 KB) are needed instead of a
+ *              25.6 KB frame buffer.
+ * @version     0.1
+ * @date        2022-03-15
+ */
+
+#include "lcd_tile.h"
+#include "lcd_dma.h"
+#include "ramfunc.h"
+#include "string.h"
+
+#define TILE_PIXELS             (TILE_W * TILE_H)
+
+static tile_item_t items[TILE_MAX_ITEMS];
+static uint8_t item_count;
+static uint16_t background_color;
+
+static uint32_t dirty;                  // One bit per tile
+static uint32_t valid;                  // Tiles whose hash matches the panel
+static uint32_t owned;                  // Tiles drawn by the renderer
+static uint32_t tile_hash[TILE_COUNT];
+
+static uint16_t buffers[2][TILE_PIXELS];
+static uint32_t buffer_mark[2];         // lcd_dma_mark() after the buffer was queued
+static uint8_t buffer_next;
+
+/**
+ * @return      One bit for every tile a rectangle touches.
+ */
+static uint32_t _tiles(int x, int y, int width, int height)
+{
+    uint32_t bits = 0;
+    int column, row;
+
+    if (width <= 0 || height <= 0)
+        return 0;
+    for (row = y / TILE_H; row <= (y + height - 1) / TILE_H && row < TILE_ROWS; row++)
+        for (column = x / TILE_W; column <= (x + width - 1) / TILE_W && column < TILE_COLUMNS; column++)
+            bits |= 1UL << (row * TILE_COLUMNS + column);
+    return bits;
+}
+
+/**
+ * @brief       Marks every tile a rectangle touches as dirty.
+ *
+ * @return      The tiles that were marked.
+ */
+static uint32_t _mark(int x, int y, int width, int height)
+{
+    uint32_t bits = _tiles(x, y, width, height);
+
+    __atomic_fetch_or(&dirty, bits, __ATOMIC_RELAXED);
+    return bits;
+}
+
+/**
+ * @brief       FNV-1a over the pixels of a tile.
+ */
+RAMFUNC static uint32_t _hash(const uint16_t *buffer)
+{
+    const uint32_t *words = (const uint32_t *) buffer;
+    uint32_t hash = 2166136261UL;
+    int i;
+
+    for (i = 0; i < TILE_PIXELS / 2; i++) {
+        hash ^= words[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+/**
+ * @brief       Draws every item overlapping a tile into a pixel buffer. With
+ *              _hash() this is most of the cycles of a display update, so both
+ *              run from SRAM.
+ */
+RAMFUNC static void _render(int tile, uint16_t *buffer)
+{
+    int x0 = (tile % TILE_COLUMNS) * TILE_W;
+    int y0 = (tile / TILE_COLUMNS) * TILE_H;
+    uint16_t color = background_color;
+    int i, x, y;
+
+    for (i = 0; i < TILE_PIXELS; i++)
+        buffer[i] = color;
+
+    for (i = 0; i < item_count; i++) {
+        const tile_item_t *item = &items[i];
+        int left = item->x > x0 ? item->x : x0;
+        int right = item->x + item->width < x0 + TILE_W ? item->x + item->width : x0 + TILE_W;
+        int top = item->y > y0 ? item->y : y0;
+        int bottom = item->y + item->height < y0 + TILE_H ? item->y + item->height : y0 + TILE_H;
+        uint16_t foreground = item->foreground;
+        uint16_t background = item->background;
+
+        if (left >= right || top >= bottom)
+            continue;
+
+        for (y = top; y < bottom; y++) {
+            uint16_t *out = &buffer[(y - y0) * TILE_W + left - x0];
+
+            if (item->type == TILE_ITEM_FILL) {
+                for (x = left; x < right; x++)
+                    *out++ = background;
+                continue;
+            }
+
+            for (x = left; x < right; x++) {
+                int offset = x - item->x;
+                uint8_t glyph = item->text[offset / TILE_FONT_W] - ' ';
+                uint8_t bits = asc2_1608[glyph * TILE_FONT_H + y - item->y];
+                /* Bit 0 is the leftmost pixel, as in LCD_ShowChar */
+                *out++ = (bits >> (offset % TILE_FONT_W)) & 1 ? foreground : background;
+            }
+        }
+    }
+}
+
+/**
+ * @brief       Clears the item list and schedules a full redraw.
+ *
+ * @param[in]   background: colour of the screen where there are no items.
+ *
+ * @return      None.
+ */
+void tile_init(uint16_t background)
+{
+    item_count = 0;
+    background_color = background;
+    owned = _tiles(0, 0, LCD_W, LCD_H);
+    buffer_mark[0] = buffer_mark[1] = lcd_dma_mark();
+    buffer_next = 0;
+    tile_invalidate_all();
+}
+
+/**
+ * @brief       Adds a filled rectangle.
+ *
+ * @return      The item handle, or -1 if the item list is full.
+ */
+int tile_add_fill(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint16_t color)
+{
+    tile_item_t *item;
+
+    if (item_count == TILE_MAX_ITEMS)
+        return -1;
+    item = &items[item_count];
+    item->type = TILE_ITEM_FILL;
+    item->x = x;
+    item->y = y;
+    item->width = width;
+    item->height = height;
+    item->foreground = item->background = color;
+    item->text[0] = '\0';
+    _mark(x, y, width, height);
+    return item_count++;
+}
+
+/**
+ * @brief       Adds a text field of a fixed number of characters, initially blank.
+ *
+ * @param[in]   length: characters in the field, at most TILE_TEXT_LENGTH.
+ *
+ * @return      The item handle, or -1 if the item list is full.
+ */
+int tile_add_text(uint8_t x, uint8_t y, uint8_t length, uint16_t foreground, uint16_t background)
+{
+    tile_item_t *item;
+
+    if (item_count == TILE_MAX_ITEMS)
+        return -1;
+    if (length > TILE_TEXT_LENGTH)
+        length = TILE_TEXT_LENGTH;
+    item = &items[item_count];
+    item->type = TILE_ITEM_TEXT;
+    item->x = x;
+    item->y = y;
+    item->width = length * TILE_FONT_W;
+    item->height = TILE_FONT_H;
+    item->foreground = foreground;
+    item->background = background;
+    memset(item->text, ' ', length);
+    item->text[length] = '\0';
+    _mark(x, y, item->width, item->height);
+    return item_count++;
+}
+
+/**
+ * @brief       Changes the text of a field. The text is padded with spaces or
+ *              cut to the field length. Only marks tiles dirty if it differs,
+ *              so it is cheap to call with the same text every sample. Call
+ *              from the main loop: the text is copied without a lock, so a
+ *              tile_flush() it interrupted could render half of it.
+ *
+ * @return      None.
+ */
+void tile_set_text(int item, const char *text)
+{
+    char padded[TILE_TEXT_LENGTH + 1];
+    tile_item_t *target;
+    int length, i;
+
+    if (item < 0 || item >= item_count || items[item].type != TILE_ITEM_TEXT)
+        return;
+    target = &items[item];
+    length = target->width / TILE_FONT_W;
+
+    for (i = 0; i < length && text[i]; i++)
+        padded[i] = text[i] >= ' ' && text[i] <= '~' ? text[i] : '?';
+    for (; i < length; i++)
+        padded[i] = ' ';
+
+    if (!memcmp(padded, target->text, length))
+        return;
+    memcpy(target->text, padded, length);
+    _mark(target->x, target->y, target->width, target->height);
+}
+
+/**
+ * @brief       Changes the colours of an item (the fill colour of a rectangle
+ *              is its background).
+ *
+ * @return      None.
+ */
+void tile_set_colors(int item, uint16_t foreground, uint16_t background)
+{
+    tile_item_t *target;
+
+    if (item < 0 || item >= item_count)
+        return;
+    target = &items[item];
+    if (target->foreground == foreground && target->background == background)
+        return;
+    target->foreground = foreground;
+    target->background = background;
+    _mark(target->x, target->y, target->width, target->height);
+}
+
+/**
+ * @brief       Marks an area as dirty, e.g. after drawing over it directly.
+ *
+ * @return      None.
+ */
+void tile_invalidate(uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    valid &= ~_mark(x, y, width, height);
+}
+
+/**
+ * @brief       Limits the renderer to the tiles inside a rectangle, leaving the
+ *              rest of the screen to other drawing code (e.g. a chart).
+ *
+ * @return      None.
+ */
+void tile_set_owned(uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    owned = _tiles(x, y, width, height);
+}
+
+/**
+ * @brief       Forces every tile to be sent on the next flush.
+ *
+ * @return      None.
+ */
+void tile_invalidate_all(void)
+{
+    valid = 0;
+    _mark(0, 0, LCD_W, LCD_H);
+}
+
+/**
+ * @brief       Renders and sends the dirty tiles. Overlapping changes since the
+ *              last flush are sent once. Call at the frame rate from the main loop.
+ *
+ * @return      None.
+ */
+void tile_flush(void)
+{
+    uint32_t pending = __atomic_exchange_n(&dirty, 0, __ATOMIC_RELAXED) & owned;
+    int tile;
+
+    for (tile = 0; pending; tile++, pending >>= 1) {
+        uint16_t *buffer = buffers[buffer_next];
+        uint32_t hash;
+        int x, y;
+
+        if (!(pending & 1))
+            continue;
+
+        /* The DMA may still be reading this buffer from two tiles ago */
+        lcd_dma_wait(buffer_mark[buffer_next]);
+        _render(tile, buffer);
+        hash = _hash(buffer);
+        if ((valid & (1UL << tile)) && tile_hash[tile] == hash)
+            continue;
+        tile_hash[tile] = hash;
+        valid |= 1UL << tile;
+
+        x = (tile % TILE_COLUMNS) * TILE_W;
+        y = (tile / TILE_COLUMNS) * TILE_H;
+        LCD_Address_Set(x, y, x + TILE_W - 1, y + TILE_H - 1);
+        lcd_dma_buffer16(OLED_DATA, buffer, TILE_PIXELS);
+        buffer_mark[buffer_next] = lcd_dma_mark();
+        buffer_next ^= 1;
+    }
+}
+
+#ifdef RAMFUNC_BENCHMARK
+/**
+ * @brief       Renders and hashes one tile of the current screen into a buffer
+ *              of the caller, as tile_flush() does, without sending it.
+ *
+ * @param[in]   tile: tile number, 0 to TILE_COUNT - 1.
+ * @param[out]  buffer: TILE_W * TILE_H pixels.
+ *
+ * @return      The hash of the tile.
+ */
+uint32_t tile_benchmark(int tile, uint16_t *buffer)
+{
+    _render(tile, buffer);
+    return _hash(buffer);
+}
+#endif /* RAMFUNC_BENCHMARK */
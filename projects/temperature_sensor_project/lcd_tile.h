@@ -0,0 +1,64 @@
+/**
+ * @file        lcd_tile.h
+ * @brief       Retained-mode renderer for the 160x80 LCD. The screen is a list
+ *              of items (text fields and filled rectangles). Changing an item
+ *              marks the tiles it covers as dirty; tile_flush() renders each
+ *              dirty tile into a small off-screen buffer and sends it with one
+ *              address window, skipping tiles whose pixels did not change.
+ * @version     0.1
+ * @date        2022-03-15
+ */
+
+#ifndef LCD_TILE_H
+#define LCD_TILE_H
+
+#include "stdint.h"
+#include "lcd.h"
+#include "ramfunc.h"
+
+#define TILE_W                  32
+#define TILE_H                  16
+#define TILE_COLUMNS            (LCD_W / TILE_W)
+#define TILE_ROWS               (LCD_H / TILE_H)
+#define TILE_COUNT              (TILE_COLUMNS * TILE_ROWS)  // At most 32, one bit each
+
+#define TILE_MAX_ITEMS          16
+#define TILE_TEXT_LENGTH        20  // Characters per text item (a full row)
+
+#define TILE_FONT_W             8
+#define TILE_FONT_H             16
+
+typedef enum {
+    TILE_ITEM_FILL,             // Rectangle in the background colour
+    TILE_ITEM_TEXT              // One row of 8x16 text, padded with the background colour
+} TILE_ITEM_TYPE;
+
+/**
+ * @brief One element of the retained screen.
+ */
+typedef struct {
+    uint8_t type;
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+    uint16_t foreground;
+    uint16_t background;
+    char text[TILE_TEXT_LENGTH + 1];
+} tile_item_t;
+
+void tile_init(uint16_t background);
+int tile_add_fill(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint16_t color);
+int tile_add_text(uint8_t x, uint8_t y, uint8_t length, uint16_t foreground, uint16_t background);
+void tile_set_text(int item, const char *text);
+void tile_set_colors(int item, uint16_t foreground, uint16_t background);
+void tile_invalidate(uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+void tile_invalidate_all(void);
+void tile_set_owned(uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+void tile_flush(void);
+
+#ifdef RAMFUNC_BENCHMARK
+uint32_t tile_benchmark(int tile, uint16_t *buffer);
+#endif
+
+#endif /* LCD_TILE_H */
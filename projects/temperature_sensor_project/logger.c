@@ -0,0 +1,163 @@
+/**
+ * @file        logger.c
+ * @brief       Message ring and packet encoder of the deferred formatting log.
+ * @version     0.1
+ * @date        2022-03-19
+ */
+
+#include "logger.h"
+#include "gd32vf103.h"
+#include "riscv_encoding.h"
+
+static uint32_t ring[LOG_WORDS];
+static uint32_t log_head;               // Words reserved, may be set from interrupts
+static uint32_t log_tail;               // Words drained
+static uint32_t log_dropped;
+
+/**
+ * @brief       Reserves room for a message. Writers claim their words with a
+ *              compare and swap, so a message interrupted half way keeps them.
+ *
+ * @return      The first word of the message, or NULL if the ring is full.
+ */
+static uint32_t *_reserve(uint32_t words, uint32_t *start)
+{
+    uint32_t at = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+
+    do {
+        if (at + words - __atomic_load_n(&log_tail, __ATOMIC_ACQUIRE) > LOG_WORDS) {
+            __atomic_fetch_add(&log_dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&log_head, &at, at + words, 1,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *start = at;
+    return &ring[at & LOG_MASK];
+}
+
+/**
+ * @brief       Completes a message by writing its header, which tells the
+ *              reader the words before it are valid.
+ */
+static void _commit(uint32_t *header, uint16_t id, uint8_t level, uint32_t words)
+{
+    __atomic_store_n(header, LOG_MARKER | (level & 0xF) << 8 | (words & 0xF) << 12 | (uint32_t) id << 16,
+                     __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief       Stores a message with int sized arguments. Use the LOG macros.
+ *
+ * @return      None.
+ */
+void logger_write(uint16_t id, uint8_t level, uint32_t count, const uint32_t *arguments)
+{
+    uint32_t *header, start, i;
+
+    if (count > LOG_MAX_ARGUMENTS)
+        count = LOG_MAX_ARGUMENTS;
+    if (!(header = _reserve(2 + count, &start)))
+        return;
+    ring[(start + 1) & LOG_MASK] = read_csr(mcycle);
+    for (i = 0; i < count; i++)
+        ring[(start + 2 + i) & LOG_MASK] = arguments[i];
+    _commit(header, id, level, count);
+}
+
+/**
+ * @brief       Stores a message with one string argument, copied as a length
+ *              word and the characters. Use LOG_STRING.
+ *
+ * @return      None.
+ */
+void logger_write_string(uint16_t id, uint8_t level, const char *string)
+{
+    uint32_t *header, start, length = 0, words, i;
+
+    while (length < LOG_STRING_MAX && string[length])
+        length++;
+    words = 1 + (length + 3) / 4;
+    if (!(header = _reserve(2 + words, &start)))
+        return;
+    ring[(start + 1) & LOG_MASK] = read_csr(mcycle);
+    ring[(start + 2) & LOG_MASK] = length;
+    for (i = 0; i < length; i += 4) {
+        uint32_t word = 0;
+        int j;
+        for (j = 0; j < 4 && i + j < length; j++)
+            word |= (uint32_t) (uint8_t) string[i + j] << (8 * j);
+        ring[(start + 3 + i / 4) & LOG_MASK] = word;
+    }
+    _commit(header, id, level, words);
+}
+
+/**
+ * @brief       Records a core clock switch. Called by clock_set(), with
+ *              interrupts off, right after the switch.
+ *
+ * @return      None.
+ */
+void logger_clock(uint32_t old_hz, uint32_t new_hz)
+{
+    uint32_t mhz = (old_hz / 1000000) << 8 | new_hz / 1000000;
+
+    logger_write(0, LOG_LEVEL_CLOCK, 1, &mhz);
+}
+
+static uint8_t *_put32(uint8_t *out, uint32_t value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+    return out + 4;
+}
+
+/**
+ * @brief       Packs the stored messages into a packet (see logger.h). Messages
+ *              that do not fit stay for the next drain. Call from the main loop
+ *              only.
+ *
+ * @param[out]  buffer: where the packet is written.
+ * @param[in]   size: size of the buffer, at least LOG_HEADER_BYTES.
+ *
+ * @return      The length of the packet, 0 if the buffer is too small.
+ */
+uint32_t logger_drain(uint8_t *buffer, uint32_t size)
+{
+    uint64_t now = get_cycle_value();
+    uint8_t *out = buffer + LOG_HEADER_BYTES;
+    uint8_t *end = buffer + size;
+
+    if (size < LOG_HEADER_BYTES)
+        return 0;
+
+    while (log_tail != __atomic_load_n(&log_head, __ATOMIC_RELAXED)) {
+        uint32_t *header = &ring[log_tail & LOG_MASK];
+        uint32_t value = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+        uint32_t words, i;
+
+        if ((value & 0xFF) != LOG_MARKER)
+            break;                      // Still being written by an interrupted writer
+        words = 2 + ((value >> 12) & 0xF);
+        if (out + 4 * words > end)
+            break;
+        /* Free words are kept zero, so a header reserved but not yet
+           committed can never look like a message */
+        for (i = 0; i < words; i++) {
+            out = _put32(out, ring[(log_tail + i) & LOG_MASK]);
+            ring[(log_tail + i) & LOG_MASK] = 0;
+        }
+        __atomic_store_n(&log_tail, log_tail + words, __ATOMIC_RELEASE);
+    }
+
+    buffer[0] = 'L';
+    buffer[1] = 'G';
+    buffer[2] = LOG_VERSION;
+    buffer[3] = 0;
+    _put32(buffer + 4, SystemCoreClock);
+    _put32(buffer + 8, __atomic_exchange_n(&log_dropped, 0, __ATOMIC_RELAXED));
+    _put32(buffer + 12, now);
+    _put32(buffer + 16, now >> 32);
+    return out - buffer;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file        logger.h
+ * @brief       Deferred formatting log. A call site stores only the id of its
+ *              format string and the raw 32-bit arguments in a ring; the text
+ *              is put together on a PC by tools/log_decode.py from the ELF file.
+ *              The format strings live in the non-loaded section .logstr, so
+ *              they take no flash, and the id is the string's offset in it.
+ *
+ *              LOG_INFO("sample %d of %u", value, count);
+ *              LOG_STRING(LOG_LEVEL_DEBUG, "AT > %s", command);
+ *
+ *              Arguments are int sized (%d %i %u %x %X %o %c, with flags and
+ *              width); LOG_STRING copies one string of up to LOG_STRING_MAX
+ *              characters. A message costs 8 bytes plus 4 per argument and may
+ *              be written from interrupts. Messages that do not fit in the ring
+ *              are dropped and counted.
+ *
+ *              logger_drain() packs the stored messages into a packet:
+ *
+ *                  offset  size
+ *                  0       2       "LG"
+ *                  2       1       LOG_VERSION
+ *                  3       1       reserved
+ *                  4       4       core clock in Hz
+ *                  8       4       messages dropped before these
+ *                  12      8       mcycle when the packet was made
+ *                  20      ...     messages, 32-bit little-endian words:
+ *                                  header (0xA5 | level << 8 | words << 12 |
+ *                                  id << 16), time (low 32 bits of mcycle),
+ *                                  then the arguments
+ *
+ *              mcycle counts at the core clock of the moment, and the header
+ *              only gives the clock at the drain. clock_set() therefore calls
+ *              logger_clock(), which stores a LOG_LEVEL_CLOCK record with one
+ *              argument, old MHz << 8 | new MHz, so the decoder converts each
+ *              stretch at its own clock.
+ * @version     0.1
+ * @date        2022-03-19
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "stdint.h"
+
+/**
+ * @brief If defined, a log packet is published over MQTT every
+ *        LOG_PUBLISH_READINGS sensor readings.
+ */
+//#define LOG_PUBLISH
+#define LOG_PUBLISH_READINGS    60
+
+/**
+ * @brief Messages below this level are compiled out.
+ */
+#define LOG_LEVEL               LOG_LEVEL_DEBUG
+
+#define LOG_VERSION             2
+#define LOG_WORDS               256     // Ring size in 32-bit words, a power of two
+#define LOG_MASK                (LOG_WORDS - 1)
+#define LOG_MAX_ARGUMENTS       8
+#define LOG_STRING_MAX          48
+#define LOG_HEADER_BYTES        20
+#define LOG_MARKER              0xA5
+
+#define LOG_LEVEL_DEBUG         0
+#define LOG_LEVEL_INFO          1
+#define LOG_LEVEL_WARN          2
+#define LOG_LEVEL_ERROR         3
+#define LOG_LEVEL_CLOCK         15      // Not a message, a clock switch (logger_clock())
+
+/**
+ * @brief The id of a format string, placed in .logstr. The section flags are
+ *        given in the name ("" = not allocated); the trailing # comments out
+ *        the flags the compiler appends.
+ */
+#define LOG_FORMAT_ID(format) ({ \
+    __attribute__( ( section( ".logstr,\"\",@progbits #" ), used ) ) \
+    static const char log_format[] = format; \
+    (uint16_t) (uintptr_t) log_format; })
+
+#define LOG(level, format, ...) do { \
+    if ((level) >= LOG_LEVEL) { \
+        const uint32_t log_arguments[] = { 0, ##__VA_ARGS__ }; \
+        logger_write(LOG_FORMAT_ID(format), level, \
+                     sizeof log_arguments / sizeof log_arguments[0] - 1, log_arguments + 1); \
+    } } while (0)
+
+#define LOG_STRING(level, format, string) do { \
+    if ((level) >= LOG_LEVEL) \
+        logger_write_string(LOG_FORMAT_ID(format), level, string); \
+    } while (0)
+
+#define LOG_DEBUG(...)          LOG(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)           LOG(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...)           LOG(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...)          LOG(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+void logger_write(uint16_t id, uint8_t level, uint32_t count, const uint32_t *arguments);
+void logger_write_string(uint16_t id, uint8_t level, const char *string);
+void logger_clock(uint32_t old_hz, uint32_t new_hz);
+uint32_t logger_drain(uint8_t *buffer, uint32_t size);
+
+#endif /* LOGGER_H */
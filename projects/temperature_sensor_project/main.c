@@ -16,25 +16,37 @@ Libraries (other than vendor SDK and gcc libraries) must have .h-files in /lib/[
 #include "wifi.h"
 #include "mqtt.h"
 #include "debug.h"
+#include "status_display.h"
+#include "profile.h"
+#include "pool.h"
+#include "power.h"
+#include "clock.h"
+
+PROFILE_REGION(display);
 
 #define EI 1
 #define DI 0
 
 int main(void){  
-    int ms=0, s=0, key, pKey=-1, c=0, idle=0;
+    int ms=0, s=0, key, pKey=-1, c=0, idle=0, reporting=0;
     int ms2 = 0;
+    uint32_t elapsed;
     int lookUpTbl[16]={1,4,7,14,2,5,8,0,3,6,9,15,10,11,12,13};
     char msg[]="*";
 
     t5omsi();                               // Initialize timer5 1kHz
+    pool_init();                            // Message and command buffers
     //colinit();                              // Initialize column toolbox
     //l88init();                              // Initialize 8*8 led toolbox
     //keyinit();                              // Initialize keyboard toolbox
     Lcd_SetType(LCD_INVERTED);              // LCD_INVERTED/LCD_NORMAL!
-    Lcd_Init();
-    LCD_Clear(RED);
-    u0init(DI,&wifi_uart_data_recieved_callback); // Initialize USART0 toolbox
+    Lcd_Init();                             // Runs on from LCD_WR_Queue()
+    status_display_init();
+    u0init(EI,&wifi_uart_data_recieved_callback); // Initialize USART0 toolbox, RX wakes from sleep
+    power_init();                           // Tickless idle
     temp_sensor_init();
+    clock_init();                           // Idle clock, after the drivers have registered
+    profile_reset();                        // Profile from here on
 
 
     // Example to connect and send a message over MQTT
@@ -43,6 +55,7 @@ int main(void){
         //mqtt_send_message_string(MQTT_SUBTOPIC_REFRIGERATOR_1, MQTT_MSG_CONTENT_CHECK);
         //mqtt_send_message_one_decimal(MQTT_SUBTOPIC_TEMP_DEBUG_REFRIGERATOR_1, 25, 2);
         //
+        status_display_set_connection(1);
         eclic_global_interrupt_enable();        // !!!!! Enable Interrupt !!!!!
     }
 
@@ -50,15 +63,28 @@ int main(void){
         idle++;                             // Manage Async events
         LCD_WR_Queue();                     // Manage LCD com queue!
         u0_TX_Queue();                      // Manage U(S)ART TX Queue!
+        temp_sensor_poll();                 // Process and publish the readings
         //if (usart_flag_get(USART0,USART_FLAG_RBNE)){ // USART0 RX?
         //    LCD_ShowChar(30,50,usart_data_receive(USART0), OPAQUE, WHITE);
         //}
 
-        if (t5expq()) {                     // Manage periodic tasks
+        elapsed = t5expq();                 // Sleep until the next frame...
+        if (!elapsed)                       // ...or interrupt, catching up the ticks
+            elapsed = power_idle(status_display_idle_ms());
+
+        while (elapsed--) {                 // Manage periodic tasks
             //l88row(colset());               // ...8*8LED and Keyboard
+            PROFILE_BEGIN(display);
+            if (!reporting)
+                status_display_tick();      // ...Status screen frames
+            PROFILE_END(display);
+            clock_poll();                   // ...Clock switches refused earlier
             ms++;                           // ...One second heart beat
             if (ms==1000){
                 ms=0;
+#ifdef DEBUG_REPORTS
+                reporting = debug_report_tick(); // ...Debug reports in turn
+#endif
                 //l88mem(0,s++);
                 //msg[0]=(s%10)+'0'; putstr(msg);   // TX LSD time
                 //LCD_ShowNum(8, 50, 0, 1, WHITE);  // LCD Clear key pressed
@@ -0,0 +1,396 @@
+/**
+ * @file        mem.c
+ * @brief       Word at a time memory and string functions, see mem.h.
+ * @version     0.1
+ * @date        2022-03-25
+ */
+
+#include "mem.h"
+
+#define WORD_MASK   3
+#define ONES        0x01010101UL
+#define HIGHS       0x80808080UL
+#define SMALL       8               // Shorter calls are done bytewise
+
+typedef uint32_t __attribute__( ( may_alias ) ) word_t;
+
+/* Keeps GCC from turning the loops back into calls to these very functions */
+#define MEM_FUNC    __attribute__( ( optimize( "no-tree-loop-distribute-patterns" ) ) )
+
+/**
+ * @brief       Copies words between word aligned buffers, eight at a time.
+ */
+MEM_FUNC static inline void _copy_words(word_t *d, const word_t *s, size_t words)
+{
+    for (; words >= 8; words -= 8, d += 8, s += 8) {
+        uint32_t w0 = s[0], w1 = s[1], w2 = s[2], w3 = s[3];
+        uint32_t w4 = s[4], w5 = s[5], w6 = s[6], w7 = s[7];
+        d[0] = w0; d[1] = w1; d[2] = w2; d[3] = w3;
+        d[4] = w4; d[5] = w5; d[6] = w6; d[7] = w7;
+    }
+    while (words--)
+        *d++ = *s++;
+}
+
+/**
+ * @brief       Copies words to an aligned destination from a misaligned
+ *              source. Aligned words are read and every output word is made
+ *              from two of them (little endian, lower address in the low bits).
+ */
+MEM_FUNC static inline void _copy_shifted(word_t *d, const uint8_t *s, size_t words)
+{
+    unsigned shift = ((uintptr_t) s & WORD_MASK) * 8;
+    const word_t *w = (const word_t *) ((uintptr_t) s & ~(uintptr_t) WORD_MASK);
+    uint32_t low = *w++, high;
+
+    for (; words >= 4; words -= 4, d += 4, w += 4) {
+        high = w[0];
+        d[0] = low >> shift | high << (32 - shift);
+        low = w[1];
+        d[1] = high >> shift | low << (32 - shift);
+        high = w[2];
+        d[2] = low >> shift | high << (32 - shift);
+        low = w[3];
+        d[3] = high >> shift | low << (32 - shift);
+    }
+    while (words--) {
+        high = *w++;
+        *d++ = low >> shift | high << (32 - shift);
+        low = high;
+    }
+}
+
+/**
+ * @brief       Forward copy. Every word is read before it is written, so this
+ *              is also safe for overlapping buffers with dest below src.
+ */
+MEM_FUNC static inline void _copy_forward(uint8_t *d, const uint8_t *s, size_t n)
+{
+    if (n >= SMALL) {
+        size_t words;
+
+        while ((uintptr_t) d & WORD_MASK) {
+            *d++ = *s++;
+            n--;
+        }
+        words = n / 4;
+        if ((uintptr_t) s & WORD_MASK)
+            _copy_shifted((word_t *) d, s, words);
+        else
+            _copy_words((word_t *) d, (const word_t *) s, words);
+        d += words * 4;
+        s += words * 4;
+        n &= WORD_MASK;
+    }
+    while (n--)
+        *d++ = *s++;
+}
+
+/**
+ * @brief       Backward copy for overlapping buffers with dest above src. Only
+ *              buffers with the same alignment are copied by words.
+ */
+MEM_FUNC static inline void _copy_backward(uint8_t *d, const uint8_t *s, size_t n)
+{
+    d += n;
+    s += n;
+    if (n >= SMALL && !(((uintptr_t) d ^ (uintptr_t) s) & WORD_MASK)) {
+        word_t *dw;
+        const word_t *sw;
+
+        while ((uintptr_t) d & WORD_MASK) {
+            *--d = *--s;
+            n--;
+        }
+        dw = (word_t *) d;
+        sw = (const word_t *) s;
+        for (; n >= 16; n -= 16) {
+            uint32_t w3 = sw[-1], w2 = sw[-2], w1 = sw[-3], w0 = sw[-4];
+            dw[-1] = w3; dw[-2] = w2; dw[-3] = w1; dw[-4] = w0;
+            dw -= 4;
+            sw -= 4;
+        }
+        for (; n >= 4; n -= 4)
+            *--dw = *--sw;
+        d = (uint8_t *) dw;
+        s = (const uint8_t *) sw;
+    }
+    while (n--)
+        *--d = *--s;
+}
+
+MEM_FUNC void *MEM_NAME(memcpy)(void *restrict dest, const void *restrict src, size_t n)
+{
+    _copy_forward(dest, src, n);
+    return dest;
+}
+
+MEM_FUNC void *MEM_NAME(memmove)(void *dest, const void *src, size_t n)
+{
+    if ((uintptr_t) dest - (uintptr_t) src >= n)
+        _copy_forward(dest, src, n);    // dest below src, or no overlap
+    else
+        _copy_backward(dest, src, n);
+    return dest;
+}
+
+MEM_FUNC void *MEM_NAME(memset)(void *dest, int c, size_t n)
+{
+    uint8_t *d = dest;
+
+    if (n >= SMALL) {
+        uint32_t fill = (uint8_t) c * ONES;
+        word_t *w;
+
+        while ((uintptr_t) d & WORD_MASK) {
+            *d++ = (uint8_t) c;
+            n--;
+        }
+        w = (word_t *) d;
+        for (; n >= 32; n -= 32, w += 8) {
+            w[0] = fill; w[1] = fill; w[2] = fill; w[3] = fill;
+            w[4] = fill; w[5] = fill; w[6] = fill; w[7] = fill;
+        }
+        for (; n >= 4; n -= 4)
+            *w++ = fill;
+        d = (uint8_t *) w;
+    }
+    while (n--)
+        *d++ = (uint8_t) c;
+    return dest;
+}
+
+/**
+ * @brief       Compares words while both buffers have the same alignment,
+ *              finds the differing byte bytewise.
+ */
+MEM_FUNC int MEM_NAME(memcmp)(const void *s1, const void *s2, size_t n)
+{
+    const uint8_t *a = s1, *b = s2;
+
+    if (n >= SMALL && !(((uintptr_t) a ^ (uintptr_t) b) & WORD_MASK)) {
+        while ((uintptr_t) a & WORD_MASK) {
+            if (*a != *b)
+                return *a - *b;
+            a++;
+            b++;
+            n--;
+        }
+        while (n >= 4 && *(const word_t *) a == *(const word_t *) b) {
+            a += 4;
+            b += 4;
+            n -= 4;
+        }
+    }
+    for (; n; n--, a++, b++) {
+        if (*a != *b)
+            return *a - *b;
+    }
+    return 0;
+}
+
+/**
+ * @brief       (w - 0x01..) & ~w & 0x80.. is non-zero only if a byte of w is 0.
+ */
+MEM_FUNC size_t MEM_NAME(strlen)(const char *s)
+{
+    const char *p = s;
+    const word_t *w;
+
+    for (; (uintptr_t) p & WORD_MASK; p++) {
+        if (!*p)
+            return p - s;
+    }
+    for (w = (const word_t *) p; !((*w - ONES) & ~*w & HIGHS); w++)
+        ;
+    for (p = (const char *) w; *p; p++)
+        ;
+    return p - s;
+}
+
+#ifdef MEM_BENCHMARK
+#include "riscv_encoding.h"
+#include <stdio.h>
+
+#define MEM_BENCHMARK_RUNS  8           // The fastest run is kept
+
+enum { MEM_CPY, MEM_MOVE, MEM_SET, MEM_CMP, MEM_LEN, MEM_FUNCTIONS };
+
+static uint8_t source[MEM_BENCHMARK_SIZE + 8];
+static uint8_t buffer[MEM_BENCHMARK_SIZE + 8];
+static uint8_t reference[MEM_BENCHMARK_SIZE + 8];
+static uint32_t errors[MEM_FUNCTIONS];
+static volatile uint32_t sink;          // Keeps the results alive
+
+/* The byte loops the functions are checked and timed against */
+MEM_FUNC __attribute__( ( noinline ) ) static void _byte_copy(uint8_t *d, const uint8_t *s, size_t n)
+{
+    while (n--)
+        *d++ = *s++;
+}
+
+MEM_FUNC __attribute__( ( noinline ) ) static void _byte_move(uint8_t *d, const uint8_t *s, size_t n)
+{
+    if (d < s) {
+        _byte_copy(d, s, n);
+    } else {
+        while (n--)
+            d[n] = s[n];
+    }
+}
+
+MEM_FUNC __attribute__( ( noinline ) ) static void _byte_set(uint8_t *d, int c, size_t n)
+{
+    while (n--)
+        *d++ = (uint8_t) c;
+}
+
+MEM_FUNC __attribute__( ( noinline ) ) static int _byte_cmp(const uint8_t *a, const uint8_t *b, size_t n)
+{
+    for (; n; n--, a++, b++) {
+        if (*a != *b)
+            return *a - *b;
+    }
+    return 0;
+}
+
+MEM_FUNC __attribute__( ( noinline ) ) static size_t _byte_len(const char *s)
+{
+    size_t n = 0;
+
+    while (s[n])
+        n++;
+    return n;
+}
+
+static void _fill(uint8_t *d, size_t n, uint32_t seed)
+{
+    while (n--) {
+        seed = seed * 1103515245UL + 12345;
+        *d++ = (uint8_t) (seed >> 16) | 1;      // No zero bytes, for strlen
+    }
+}
+
+static int _sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+/**
+ * @brief       Runs every function for each size up to MEM_CHECK_SIZE and
+ *              every source and destination alignment, comparing the whole
+ *              buffer (so writes past the end are caught) with the byte loops.
+ */
+static void _check(void)
+{
+    size_t n, from, to;
+    int i;
+
+    for (i = 0; i < MEM_FUNCTIONS; i++)
+        errors[i] = 0;
+    for (n = 0; n <= MEM_CHECK_SIZE; n++) {
+        for (from = 0; from < 4; from++) {
+            for (to = 0; to < 4; to++) {
+                _fill(source, sizeof source, n * 16 + from * 4 + to);
+                _fill(buffer, sizeof buffer, 1);
+                _fill(reference, sizeof reference, 1);
+                memcpy(buffer + to, source + from, n);
+                _byte_copy(reference + to, source + from, n);
+                errors[MEM_CPY] += _byte_cmp(buffer, reference, sizeof buffer) != 0;
+
+                memmove(buffer + to, buffer + from, n);         // Overlapping both ways
+                _byte_move(reference + to, reference + from, n);
+                errors[MEM_MOVE] += _byte_cmp(buffer, reference, sizeof buffer) != 0;
+
+                memset(buffer + to, (int) (from + 0xF0), n);
+                _byte_set(reference + to, (int) (from + 0xF0), n);
+                errors[MEM_SET] += _byte_cmp(buffer, reference, sizeof buffer) != 0;
+
+                _byte_copy(buffer + to, source + from, n);
+                if (n)
+                    buffer[to + n - 1 - (from + to) % n] ^= 0x80;
+                errors[MEM_CMP] += _sign(memcmp(buffer + to, source + from, n))
+                                   != _sign(_byte_cmp(buffer + to, source + from, n));
+
+                source[from + n] = 0;
+                errors[MEM_LEN] += strlen((const char *) source + from) != n;
+            }
+        }
+    }
+}
+
+/**
+ * @brief       Fewest cycles of MEM_BENCHMARK_RUNS calls, with interrupts off.
+ */
+static uint32_t _time(int function, int fast, size_t offset)
+{
+    uint32_t status = read_csr(mstatus), best = UINT32_MAX, start, cycles;
+    size_t n = MEM_BENCHMARK_SIZE;
+    int run;
+
+    clear_csr(mstatus, MSTATUS_MIE);
+    for (run = 0; run < MEM_BENCHMARK_RUNS; run++) {
+        start = read_csr(mcycle);
+        switch (function) {
+        case MEM_CPY:
+            if (fast) memcpy(buffer, source + offset, n);
+            else _byte_copy(buffer, source + offset, n);
+            break;
+        case MEM_MOVE:
+            if (fast) memmove(buffer + 4 + offset, buffer, n);     // Backward
+            else _byte_move(buffer + 4 + offset, buffer, n);
+            break;
+        case MEM_SET:
+            if (fast) memset(buffer + offset, run, n);
+            else _byte_set(buffer + offset, run, n);
+            break;
+        case MEM_CMP:
+            sink += fast ? memcmp(buffer + offset, source + offset, n)
+                         : _byte_cmp(buffer + offset, source + offset, n);
+            break;
+        default:
+            sink += fast ? strlen((const char *) source + offset)
+                         : _byte_len((const char *) source + offset);
+        }
+        cycles = read_csr(mcycle) - start;
+        if (cycles < best)
+            best = cycles;
+    }
+    write_csr(mstatus, status);
+    return best;
+}
+
+/**
+ * @brief       Checks the functions, then prints one line per function that
+ *              fits the 20 columns of the LCD: cycles for MEM_BENCHMARK_SIZE
+ *              bytes aligned, one byte off (memcpy: the source, memmove: the
+ *              destination, the others: every buffer) and for the byte loop. A
+ *              '!' at the end marks a function that failed the check.
+ *
+ * @param[in]   print: called with every line.
+ *
+ * @return      The number of failed checks.
+ */
+uint32_t mem_benchmark(mem_print_t print)
+{
+    static const char *const names[MEM_FUNCTIONS] = { "cpy", "mov", "set", "cmp", "len" };
+    uint32_t total = 0;
+    char line[24];
+    int i;
+
+    clear_csr(CSR_MCOUNTINHIBIT, 0x5);      // CY and IR
+    _check();
+
+    _fill(source, sizeof source, 2);
+    source[MEM_BENCHMARK_SIZE + 1] = 0;     // strlen sees 256 bytes from offset 1, 257 aligned
+    _byte_copy(buffer, source, sizeof buffer);
+    for (i = 0; i < MEM_FUNCTIONS; i++) {
+        snprintf(line, sizeof line, "%-3s%5lu%5lu%6lu%c", names[i],
+                 (unsigned long) _time(i, 1, 0), (unsigned long) _time(i, 1, 1),
+                 (unsigned long) _time(i, 0, 0), errors[i] ? '!' : ' ');
+        print(line);
+        total += errors[i];
+    }
+    return total;
+}
+#endif /* MEM_BENCHMARK */
@@ -0,0 +1,56 @@
+/**
+ * @file        mem.h
+ * @brief       memcpy, memmove, memset, memcmp and strlen for the rv32imac
+ *              core. They are linked before newlib, so every call in the
+ *              firmware and in newlib itself ends up here.
+ *
+ *              The core traps on misaligned word accesses, so the copies
+ *              align the destination with single bytes and then move words,
+ *              eight per iteration. When the source is misaligned by a
+ *              different amount, aligned words are read and each output word
+ *              is put together with two shifts. strlen tests a word at a time
+ *              for a zero byte. Aligned words may be read a few bytes past the
+ *              end of a buffer, never past the word holding its last byte.
+ *
+ *              With MEM_BENCHMARK, mem_benchmark() checks the functions
+ *              against byte loops for every size up to MEM_CHECK_SIZE and
+ *              alignment, and times both on 256 bytes. tools/mem_check.c does
+ *              the same check on the host against the C library.
+ * @version     0.1
+ * @date        2022-03-25
+ */
+
+#ifndef MEM_H
+#define MEM_H
+
+#include "stdint.h"
+#include "stddef.h"
+
+/**
+ * @brief If defined, mem_benchmark() is built.
+ */
+//#define MEM_BENCHMARK
+
+#define MEM_CHECK_SIZE      67      // Every unrolled loop count and tail
+#define MEM_BENCHMARK_SIZE  256
+
+/* The host check builds them under other names, next to the C library ones */
+#ifdef MEM_HOST_TEST
+#define MEM_NAME(name)      mem_##name
+#else
+#define MEM_NAME(name)      name
+#endif
+
+void *MEM_NAME(memcpy)(void *restrict dest, const void *restrict src, size_t n);
+void *MEM_NAME(memmove)(void *dest, const void *src, size_t n);
+void *MEM_NAME(memset)(void *dest, int c, size_t n);
+int MEM_NAME(memcmp)(const void *s1, const void *s2, size_t n);
+size_t MEM_NAME(strlen)(const char *s);
+
+typedef void (*mem_print_t)(const char *line);
+
+#ifdef MEM_BENCHMARK
+uint32_t mem_benchmark(mem_print_t print);
+#endif
+
+#endif /* MEM_H */
@@ -9,6 +9,8 @@
  */
 
 #include "mqtt.h"
+#include "pool.h"
+#include "logger.h"
 
 /**
  * @brief       connects to a broker.
@@ -17,10 +19,13 @@
  */
 int connect_to_broker()
 {
-    char string_return[RECIEVE_BUFFER_SIZE + 1] = {'\0'};
+    char *string_return = pool_alloc(RECIEVE_BUFFER_SIZE + 1);
+
+    if (!string_return)
+        return 0;
     do {
         at_send("AT+MQTTUSERCFG?\r\n", WAIT_FOR_RESPONSE);
-        get_last_return_string(string_return, RECIEVE_BUFFER_SIZE);
+        get_last_return_string(string_return, RECIEVE_BUFFER_SIZE + 1);
     } while (_get_transmit_state() == AT_TIMEOUT);
 
     if (strcmp(string_return, "AT+MQTTUSERCFG?\r\n+MQTTUSERCFG:0,0,\"\",\"\",\"\",0,0,\"\"\r\n\r\nOK\r\n") == 0)
@@ -29,11 +34,11 @@ int connect_to_broker()
     // TODO: retry on timeout. 
 
     at_send("AT+MQTTCONNCFG?\r\n", WAIT_FOR_RESPONSE);
-    memset(string_return, 0, sizeof(string_return));
-    get_last_return_string(string_return, RECIEVE_BUFFER_SIZE);
+    get_last_return_string(string_return, RECIEVE_BUFFER_SIZE + 1);
 
     if (strcmp(string_return, "AT+MQTTCONNCFG?\r\n+MQTTCONNCFG:0,0,0,\"\",\"\",0,0\r\n\r\nOK\r\n") == 0)
         at_send(AT_CMD_MQTT_CONNECT, WAIT_FOR_RESPONSE);
+    pool_free(string_return);
 
     #ifdef MQTT_LCD_LOGGING
 
@@ -51,12 +56,7 @@ int connect_to_broker()
  */
 int _is_mqtt_send_message_too_long(size_t message_length) {
     if (message_length > AT_CMD_MAX_LENGTH) {
-#ifdef DEBUG
-        char error_msg[61] = {'\0'};
-        sprintf(error_msg, "AT MQTT command too long: %lu (max %d)",
-                message_length, AT_CMD_MAX_LENGTH);
-        debug_error_message(__FILE__, __LINE__, error_msg);
-#endif
+        LOG_ERROR("AT MQTT command too long: %u (max %d)", message_length, AT_CMD_MAX_LENGTH);
         return 1;
     }
     return 0;
@@ -69,19 +69,23 @@ int _is_mqtt_send_message_too_long(size_t message_length) {
  * @return     1 if successful, 0 otherwise.
  */
 int mqtt_send_message_string(char* topic, char* message) {
-    char at_command_buffer[AT_CMD_MAX_LENGTH + 1] = {'\0'};
-
-    strncpy(at_command_buffer, "AT+MQTTPUB=0,\"", AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, topic, AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, "\",\"", AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, message, AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, "\",0,0\r\n", AT_CMD_MAX_LENGTH);
+    char *at_command_buffer;
 
     if (_is_mqtt_send_message_too_long(strlen(topic) + strlen(message) +
         strlen("AT+MQTTPUB=0,\"" "\",\"" "\",0,0\r\n")))
         return 0;
+    if (!(at_command_buffer = pool_alloc(AT_CMD_MAX_LENGTH + 1)))
+        return 0;
 
+    strcpy(at_command_buffer, "AT+MQTTPUB=0,\"");
+    strcat(at_command_buffer, topic);
+    strcat(at_command_buffer, "\",\"");
+    strcat(at_command_buffer, message);
+    strcat(at_command_buffer, "\",0,0\r\n");
+
+    TRACE_INSTANT(TRACE_MQTT_PUBLISH, strlen(message));
     at_send(at_command_buffer, WAIT_FOR_RESPONSE);
+    pool_free(at_command_buffer);
 
 #ifdef MQTT_LCD_LOGGING
     char info_message[17 * 2] = {'\0'};
@@ -100,21 +104,24 @@ int mqtt_send_message_string(char* topic, char* message) {
  * @return     1 if successful, 0 otherwise.
  */
 int mqtt_send_message_one_decimal(char* topic, int integer, int decimal) {
-    char at_command_buffer[AT_CMD_MAX_LENGTH + 1] = {'\0'};
+    char *at_command_buffer;
     char one_decimal[10] = {'\0'};
 
     sprintf(one_decimal, "%d.%d", integer, decimal % 10);
-    strncpy(at_command_buffer, "AT+MQTTPUB=0,\"", AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, topic, AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, "\",\"", AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, one_decimal, AT_CMD_MAX_LENGTH);
-    strncat(at_command_buffer, "\",0,0\r\n", AT_CMD_MAX_LENGTH);
-
     if (_is_mqtt_send_message_too_long(strlen(topic) + strlen(one_decimal) +
                                        strlen("AT+MQTTPUB=0,\"" "\",\"" "\",0,0\r\n")))
         return 0;
+    if (!(at_command_buffer = pool_alloc(AT_CMD_MAX_LENGTH + 1)))
+        return 0;
+
+    strcpy(at_command_buffer, "AT+MQTTPUB=0,\"");
+    strcat(at_command_buffer, topic);
+    strcat(at_command_buffer, "\",\"");
+    strcat(at_command_buffer, one_decimal);
+    strcat(at_command_buffer, "\",0,0\r\n");
 
     at_send(at_command_buffer, WAIT_FOR_RESPONSE);
+    pool_free(at_command_buffer);
 
 #ifdef MQTT_LCD_LOGGING
     char info_message[17 * 2] = {'\0'};
@@ -123,4 +130,53 @@ int mqtt_send_message_one_decimal(char* topic, int integer, int decimal) {
 #endif
 
     return 1;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief      Send a Q7.8 temperature with one decimal for a topic over MQTT.
+ *             Unlike mqtt_send_message_one_decimal() this handles negative
+ *             temperatures and rounds the fraction.
+ * @param[out] topic The topic the message is meant for.
+ * @param      temp The temperature in Q7.8.
+ * @return     1 if successful, 0 otherwise.
+ */
+int mqtt_send_message_temperature(char* topic, temp_q8_t temp) {
+    char temperature[TEMP_Q8_STRING_LENGTH] = {'\0'};
+
+    temp_q8_format(temperature, temp);
+    return mqtt_send_message_string(topic, temperature);
+}
+
+/**
+ * @brief      Send a binary message for a topic over MQTT with AT+MQTTPUBRAW.
+ * @param[out] topic The topic the message is meant for.
+ * @param[in]  data The contents of the message.
+ * @param      length The length of the message in bytes.
+ * @return     1 if successful, 0 otherwise.
+ */
+int mqtt_send_message_raw(char* topic, const uint8_t* data, uint16_t length) {
+    char *at_command_buffer;
+
+    if (_is_mqtt_send_message_too_long(strlen(topic) + strlen("AT+MQTTPUBRAW=0,\"" "\",65535,0,0\r\n")))
+        return 0;
+    if (!(at_command_buffer = pool_alloc(AT_CMD_MAX_LENGTH + 1)))
+        return 0;
+
+    sprintf(at_command_buffer, "AT+MQTTPUBRAW=0,\"%s\",%u,0,0\r\n", topic, length);
+    TRACE_INSTANT(TRACE_MQTT_PUBLISH, length);
+
+    at_send(at_command_buffer, WAIT_FOR_RESPONSE);
+    pool_free(at_command_buffer);
+    if (_get_transmit_state() == AT_TIMEOUT)
+        return 0;
+
+    at_send_raw(data, length, WAIT_FOR_RESPONSE);
+
+#ifdef MQTT_LCD_LOGGING
+    char info_message[17 * 2] = {'\0'};
+    sprintf(info_message, "Sent: %u bytes", length);
+    LCD_ShowString(8, 40, (const u8 *) info_message, WHITE);
+#endif
+
+    return 1;
+}
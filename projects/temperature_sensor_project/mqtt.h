@@ -16,7 +16,7 @@
 #include <stdio.h>
 #include "at_command.h"
 #include "usart.h"
-#include <stdio.h>
+#include "temp_fixed.h"
 
 #if defined(DEBUG) || defined(MQTT_LCD_LOGGING)
 #include "lcd.h"
@@ -53,6 +53,46 @@
  */
 #define MQTT_SUBTOPIC_REFRIGERATOR_1 MQTT_TOPIC_BASE "refrigerator/1"
 
+/**
+ * @brief MQTT topic base for batched readings (binary, see ts_codec.h).
+ */
+#define MQTT_TOPIC_BATCH_BASE "home/sensors/batch/"
+
+/**
+ * @brief MQTT subtopic for Refrigerator 1 (simulated device) batched readings
+ */
+#define MQTT_SUBTOPIC_BATCH_REFRIGERATOR_1 MQTT_TOPIC_BATCH_BASE "refrigerator/1"
+
+/**
+ * @brief MQTT topic base for status transitions ("CHECK,<cause>,<ms>").
+ */
+#define MQTT_TOPIC_EVENT_BASE "home/sensors/events/"
+
+/**
+ * @brief MQTT subtopic for Refrigerator 1 (simulated device) status transitions
+ */
+#define MQTT_SUBTOPIC_EVENT_REFRIGERATOR_1 MQTT_TOPIC_EVENT_BASE "refrigerator/1"
+
+/**
+ * @brief MQTT topic base for binary trace packets (see trace.h).
+ */
+#define MQTT_TOPIC_TRACE_BASE "home/sensors/trace/"
+
+/**
+ * @brief MQTT subtopic for Refrigerator 1 (simulated device) trace packets
+ */
+#define MQTT_SUBTOPIC_TRACE_REFRIGERATOR_1 MQTT_TOPIC_TRACE_BASE "refrigerator/1"
+
+/**
+ * @brief MQTT topic base for deferred log packets (see logger.h).
+ */
+#define MQTT_TOPIC_LOG_BASE "home/sensors/log/"
+
+/**
+ * @brief MQTT subtopic for Refrigerator 1 (simulated device) log packets
+ */
+#define MQTT_SUBTOPIC_LOG_REFRIGERATOR_1 MQTT_TOPIC_LOG_BASE "refrigerator/1"
+
 /**
  * @brief MQTT subtopic for Refrigerator 1 (simulated device)
  * TODO: Replace with dynamic MQTT subtopic solution (hardcoded solution is a proof of concept)
@@ -84,5 +124,7 @@
 int connect_to_broker();
 int mqtt_send_message_string(char* topic, char* message);
 int mqtt_send_message_one_decimal(char* topic, int integer, int decimal);
+int mqtt_send_message_temperature(char* topic, temp_q8_t temp);
+int mqtt_send_message_raw(char* topic, const uint8_t* data, uint16_t length);
 
 #endif
\ No newline at end of file
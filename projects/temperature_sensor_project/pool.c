@@ -0,0 +1,125 @@
+/**
+ * @file        pool.c
+ * @brief       Fixed size block pools, see pool.h.
+ * @version     0.1
+ * @date        2022-03-21
+ */
+
+#include "pool.h"
+#include "gd32vf103.h"
+#include "riscv_encoding.h"
+
+typedef struct pool_block {
+    struct pool_block *next;
+} pool_block_t;
+
+static uint32_t small_blocks[POOL_SMALL_BLOCKS][POOL_SMALL_BYTES / 4];
+static uint32_t medium_blocks[POOL_MEDIUM_BLOCKS][POOL_MEDIUM_BYTES / 4];
+static uint32_t large_blocks[POOL_LARGE_BLOCKS][POOL_LARGE_BYTES / 4];
+
+static struct {
+    uint8_t *start;
+    uint8_t *end;
+    pool_block_t *free;
+    pool_stats_t stats;
+} pools[POOL_CLASSES] = {
+    { (uint8_t *) small_blocks, (uint8_t *) small_blocks + sizeof small_blocks, 0,
+      { POOL_SMALL_BYTES, POOL_SMALL_BLOCKS } },
+    { (uint8_t *) medium_blocks, (uint8_t *) medium_blocks + sizeof medium_blocks, 0,
+      { POOL_MEDIUM_BYTES, POOL_MEDIUM_BLOCKS } },
+    { (uint8_t *) large_blocks, (uint8_t *) large_blocks + sizeof large_blocks, 0,
+      { POOL_LARGE_BYTES, POOL_LARGE_BLOCKS } },
+};
+
+/**
+ * @brief       Threads the free lists through the blocks. Call once at start
+ *              up, before any pool_alloc().
+ *
+ * @return      None.
+ */
+void pool_init(void)
+{
+    int i, j;
+
+    for (i = 0; i < POOL_CLASSES; i++) {
+        pools[i].free = 0;
+        for (j = pools[i].stats.blocks - 1; j >= 0; j--) {
+            pool_block_t *block = (pool_block_t *) (pools[i].start + j * pools[i].stats.size);
+            block->next = pools[i].free;
+            pools[i].free = block;
+        }
+        pools[i].stats.used = pools[i].stats.used_max = 0;
+        pools[i].stats.failed = 0;
+    }
+}
+
+/**
+ * @brief       Takes a block of at least size bytes. Interrupts are held off
+ *              while the free list changes.
+ *
+ * @param[in]   size: bytes needed.
+ *
+ * @return      The block, or NULL if no class that fits has one left.
+ */
+void *pool_alloc(uint32_t size)
+{
+    uint32_t status = read_csr(mstatus);
+    pool_block_t *block = 0;
+    int i;
+
+    clear_csr(mstatus, MSTATUS_MIE);
+    for (i = 0; i < POOL_CLASSES && !block; i++) {
+        if (size > pools[i].stats.size)
+            continue;
+        block = pools[i].free;
+        if (!block) {
+            pools[i].stats.failed++;
+            continue;
+        }
+        pools[i].free = block->next;
+        if (++pools[i].stats.used > pools[i].stats.used_max)
+            pools[i].stats.used_max = pools[i].stats.used;
+    }
+    write_csr(mstatus, status);
+    return block;
+}
+
+/**
+ * @brief       Returns a block to its pool. The block may have been taken in
+ *              another context.
+ *
+ * @param[in]   block: a block from pool_alloc(), or NULL.
+ *
+ * @return      None.
+ */
+void pool_free(void *block)
+{
+    uint32_t status;
+    int i;
+
+    if (!block)
+        return;
+    for (i = 0; i < POOL_CLASSES; i++) {
+        if ((uint8_t *) block >= pools[i].start && (uint8_t *) block < pools[i].end)
+            break;
+    }
+    if (i == POOL_CLASSES)
+        return;                         // Not ours
+
+    status = read_csr(mstatus);
+    clear_csr(mstatus, MSTATUS_MIE);
+    ((pool_block_t *) block)->next = pools[i].free;
+    pools[i].free = block;
+    pools[i].stats.used--;
+    write_csr(mstatus, status);
+}
+
+/**
+ * @return      The counters of a size class, NULL for an unknown class.
+ */
+const pool_stats_t *pool_stats(pool_class_t size_class)
+{
+    if (size_class >= POOL_CLASSES)
+        return 0;
+    return &pools[size_class].stats;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file        pool.h
+ * @brief       Fixed size block pools for message and command buffers, so the
+ *              network code does not need large stack frames. Each size class
+ *              is a free list threaded through its blocks; pool_alloc() takes
+ *              a block from the smallest class that fits and has one left,
+ *              pool_free() returns it, both in constant time. Both may be
+ *              called from interrupts, so a block can be filled in one context
+ *              and freed in another.
+ *
+ *              Blocks are not cleared; terminate strings yourself.
+ * @version     0.1
+ * @date        2022-03-21
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "stdint.h"
+
+#define POOL_SMALL_BYTES        64      // Formatted values and short messages
+#define POOL_SMALL_BLOCKS       8
+#define POOL_MEDIUM_BYTES       256     // AT commands (AT_CMD_MAX_LENGTH + 1)
+#define POOL_MEDIUM_BLOCKS      4
+#define POOL_LARGE_BYTES        1056    // AT responses and log or trace packets
+#define POOL_LARGE_BLOCKS       2
+
+typedef enum {
+    POOL_SMALL,
+    POOL_MEDIUM,
+    POOL_LARGE,
+    POOL_CLASSES
+} pool_class_t;
+
+typedef struct {
+    uint16_t size;              // Bytes per block
+    uint16_t blocks;
+    uint16_t used;              // Blocks allocated now
+    uint16_t used_max;          // High-water mark
+    uint32_t failed;            // Requests this class could not serve
+} pool_stats_t;
+
+void pool_init(void);
+void *pool_alloc(uint32_t size);
+void pool_free(void *block);
+const pool_stats_t *pool_stats(pool_class_t size_class);
+
+#endif /* POOL_H */
@@ -0,0 +1,251 @@
+/**
+ * @file        power.c
+ * @brief       Tickless idle with PMU sleep and deep-sleep, see power.h.
+ * @version     0.1
+ * @date        2022-03-22
+ */
+
+#include "power.h"
+#include "gd32vf103.h"
+#include "riscv_encoding.h"
+#include "eclicw.h"
+#include "lcd_dma.h"
+#include "usart.h"
+#include "at_command.h"
+#include "clock.h"
+#include <stdio.h>
+
+#define MTIME       ( *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIME ) )
+#define MTIMECMP    ( *( volatile uint64_t * )( TIMER_CTRL_ADDR + TIMER_MTIMECMP ) )
+
+static power_stats_t stats;
+static uint32_t wake_cycles;            // mcycle when the core last woke up
+
+/**
+ * @brief       TIMER5 update interrupt, only enabled while sleeping. Disables
+ *              itself and leaves the update flag to t5expq().
+ */
+static void _timer5_wake(void)
+{
+    TIMER_DMAINTEN(TIMER5) &= ~TIMER_DMAINTEN_UPIE;
+}
+
+/**
+ * @brief       Stops the core until an interrupt or budget_ms ticks of TIMER5.
+ *              The period is stretched from the last tick, so the ms grid is
+ *              kept.
+ *
+ * @return      Whole ms that have passed, the tick that ended the sleep included.
+ */
+static uint32_t _sleep(uint32_t budget_ms)
+{
+    uint32_t start = TIMER_CNT(TIMER5), count, elapsed;
+
+    TIMER_CAR(TIMER5) = budget_ms * 1000 - 1;
+    TIMER_DMAINTEN(TIMER5) |= TIMER_DMAINTEN_UPIE;
+    pmu_to_sleepmode(WFI_CMD);
+    TIMER_DMAINTEN(TIMER5) &= ~TIMER_DMAINTEN_UPIE;
+    count = TIMER_CNT(TIMER5);
+
+    TIMER_CAR(TIMER5) = 999;
+    if (TIMER_INTF(TIMER5) & TIMER_INTF_UPIF) {
+        TIMER_INTF(TIMER5) &= ~TIMER_INTF_UPIF;
+        if (count > stats.wake_us_max)
+            stats.wake_us_max = count;  // The counter restarted at the deadline
+        stats.sleep_us += budget_ms * 1000 - start + count;
+        elapsed = budget_ms;
+    } else {
+        TIMER_CNT(TIMER5) = count % 1000;
+        stats.sleep_us += count - start;
+        elapsed = count / 1000;
+    }
+    stats.sleeps++;
+    return elapsed;
+}
+
+#ifdef POWER_DEEPSLEEP
+static int deepsleep_ready;             // The RTC runs on LXTAL
+
+static void _rtc_wake(void)
+{
+    rtc_flag_clear(RTC_FLAG_ALARM);
+    exti_interrupt_flag_clear(EXTI_17);
+}
+
+static void _rx_wake(void)
+{
+    exti_interrupt_flag_clear(EXTI_10);
+}
+
+/**
+ * @return      How long deep-sleep may last in ms, 0 if it must not be used.
+ */
+static uint32_t _deepsleep_budget(uint32_t budget_ms)
+{
+    uint64_t now = MTIME, deadline = MTIMECMP;
+    uint32_t onewire_ms;
+
+    if (!deepsleep_ready || lcd_dma_busy() || !u0_TX_Empty() || _get_transmit_state() == WAITING)
+        return 0;
+    if (deadline <= now)
+        return 0;
+    onewire_ms = (deadline - now) / (SystemCoreClock / 4000);   // mtime runs at core/4
+    if (onewire_ms < POWER_DEEPSLEEP_WAKE_MS + POWER_DEEPSLEEP_MIN_MS)
+        return 0;
+    if (budget_ms > onewire_ms - POWER_DEEPSLEEP_WAKE_MS)
+        budget_ms = onewire_ms - POWER_DEEPSLEEP_WAKE_MS;
+    return budget_ms >= POWER_DEEPSLEEP_MIN_MS ? budget_ms : 0;
+}
+
+/**
+ * @brief       Deep-sleeps until the RTC alarm, budget_ms minus the restart
+ *              time from now, or an edge on RX.
+ *
+ * @return      Whole ms that have passed.
+ */
+static uint32_t _deepsleep(uint32_t budget_ms)
+{
+    uint32_t start, alarm, ticks;
+
+    rtc_register_sync_wait();
+    start = rtc_counter_get();
+    alarm = start + (budget_ms - POWER_DEEPSLEEP_WAKE_MS) * POWER_RTC_HZ / 1000;
+    rtc_lwoff_wait();
+    rtc_alarm_config(alarm);
+    rtc_lwoff_wait();
+    rtc_flag_clear(RTC_FLAG_ALARM);
+    exti_interrupt_flag_clear(EXTI_17 | EXTI_10);
+    exti_interrupt_enable(EXTI_10);
+
+    pmu_to_deepsleepmode(PMU_LDO_LOWPOWER, WFI_CMD);
+    clock_resume();                     // Woke up on IRC8M, restart HXTAL and the PLL
+
+    exti_interrupt_disable(EXTI_10);
+    rtc_register_sync_wait();
+    ticks = rtc_counter_get() - start;
+    if (rtc_flag_get(RTC_FLAG_ALARM)) {
+        uint32_t late = (rtc_counter_get() - alarm) * 1000000ULL / POWER_RTC_HZ;
+        if (late > stats.deepsleep_wake_us_max)
+            stats.deepsleep_wake_us_max = late;
+    }
+
+    /* mtime stopped with the core clock, keep the 1-Wire deadline in real time */
+    MTIME = MTIME + (uint64_t) ticks * (SystemCoreClock / 4) / POWER_RTC_HZ;
+    stats.deepsleeps++;
+    stats.deepsleep_us += (uint64_t) ticks * 1000000 / POWER_RTC_HZ;
+    return (uint64_t) ticks * 1000 / POWER_RTC_HZ;
+}
+#endif /* POWER_DEEPSLEEP */
+
+/**
+ * @brief       Sets up the wake-up sources. Call after t5omsi() and u0init().
+ *
+ * @return      None.
+ */
+void power_init(void)
+{
+    rcu_periph_clock_enable(RCU_PMU);
+    eclicw_enable(TIMER5_IRQn, 1, 0, &_timer5_wake);
+
+#ifdef POWER_DEEPSLEEP
+    rcu_periph_clock_enable(RCU_BKPI);
+    rcu_periph_clock_enable(RCU_AF);
+    pmu_backup_write_enable();
+    rcu_osci_on(RCU_LXTAL);
+    if (rcu_osci_stab_wait(RCU_LXTAL) == SUCCESS) {
+        rcu_rtc_clock_config(RCU_RTCSRC_LXTAL);
+        rcu_periph_clock_enable(RCU_RTC);
+        rtc_register_sync_wait();
+        rtc_lwoff_wait();
+        rtc_prescaler_set(0);
+        rtc_lwoff_wait();
+        rtc_interrupt_enable(RTC_INT_ALARM);
+        rtc_lwoff_wait();
+
+        exti_init(EXTI_17, EXTI_INTERRUPT, EXTI_TRIG_RISING);           // RTC alarm
+        gpio_exti_source_select(GPIO_PORT_SOURCE_GPIOA, GPIO_PIN_SOURCE_10);
+        exti_init(EXTI_10, EXTI_INTERRUPT, EXTI_TRIG_FALLING);          // USART0 RX start bit
+        exti_interrupt_disable(EXTI_10);
+        eclicw_enable(RTC_ALARM_IRQn, 1, 0, &_rtc_wake);
+        eclicw_enable(EXTI10_15_IRQn, 1, 0, &_rx_wake);
+        deepsleep_ready = 1;
+    }
+#endif
+    power_stats_reset();
+}
+
+/**
+ * @brief       Sleeps until the next timed job of the main loop or an
+ *              interrupt, whichever comes first. Returns at once while
+ *              interrupts are disabled, as nothing would wake the core, or if
+ *              a TIMER5 tick is already due.
+ *
+ * @param[in]   budget_ms: ticks until the next timed job, at least 1.
+ *
+ * @return      The number of 1 ms ticks that have passed, to be handled as if
+ *              t5expq() had returned true that many times.
+ */
+uint32_t power_idle(uint32_t budget_ms)
+{
+    uint32_t status = read_csr(mstatus), elapsed;
+
+    if (!(status & MSTATUS_MIE) || !budget_ms)
+        return 0;
+    clear_csr(mstatus, MSTATUS_MIE);    // Pending interrupts still end WFI
+    if (TIMER_INTF(TIMER5) & TIMER_INTF_UPIF) {
+        write_csr(mstatus, status);
+        return 0;
+    }
+    stats.awake_us += (read_csr(mcycle) - wake_cycles) / (SystemCoreClock / 1000000);
+
+#ifdef POWER_DEEPSLEEP
+    uint32_t deep_ms = _deepsleep_budget(budget_ms);
+    if (deep_ms)
+        elapsed = _deepsleep(deep_ms);
+    else
+#endif
+    elapsed = _sleep(budget_ms > POWER_SLEEP_MAX_MS ? POWER_SLEEP_MAX_MS : budget_ms);
+
+    wake_cycles = read_csr(mcycle);
+    write_csr(mstatus, status);         // The handlers of the wake-up sources run now
+    return elapsed;
+}
+
+const power_stats_t *power_stats(void)
+{
+    return &stats;
+}
+
+void power_stats_reset(void)
+{
+    stats = (power_stats_t){ 0 };
+    wake_cycles = read_csr(mcycle);
+}
+
+/**
+ * @brief       Prints the residency in each mode and the worst wake-up
+ *              latencies, in lines that fit the 20 columns of the LCD.
+ *
+ * @param[in]   print: called with every line.
+ *
+ * @return      None.
+ */
+void power_report(power_print_t print)
+{
+    uint64_t total = stats.awake_us + stats.sleep_us + stats.deepsleep_us;
+    char line[24];
+
+    if (!total)
+        total = 1;
+    snprintf(line, sizeof line, "awake %3u%%", (unsigned) (stats.awake_us * 100 / total));
+    print(line);
+    snprintf(line, sizeof line, "sleep %3u%% %7lu", (unsigned) (stats.sleep_us * 100 / total),
+             (unsigned long) stats.sleeps);
+    print(line);
+    snprintf(line, sizeof line, "deep  %3u%% %7lu", (unsigned) (stats.deepsleep_us * 100 / total),
+             (unsigned long) stats.deepsleeps);
+    print(line);
+    snprintf(line, sizeof line, "wake %5lu/%5lu us", (unsigned long) stats.wake_us_max,
+             (unsigned long) stats.deepsleep_wake_us_max);
+    print(line);
+}
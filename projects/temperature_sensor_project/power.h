@@ -0,0 +1,58 @@
+/**
+ * @file        power.h
+ * @brief       Tickless idle. When the main loop has nothing to do until its
+ *              next timed job, power_idle() stretches the 1 ms TIMER5 period to
+ *              that deadline and stops the core with WFI (PMU sleep mode). The
+ *              peripheral clocks keep running, so the 1-Wire timer, the LCD DMA
+ *              and USART0 bytes wake the core early and nothing is lost.
+ *
+ *              With POWER_DEEPSLEEP the PMU deep-sleep mode is used for longer
+ *              idle periods while nothing is in flight: no AT response
+ *              pending, USART0 and the LCD DMA idle and the 1-Wire bus in one
+ *              of its long waits. The clocks stop, so an RTC alarm (LXTAL) ends
+ *              the sleep in time for the 1-Wire deadline, and a falling edge on
+ *              RX (PA10) wakes the core for unsolicited data; the byte on that
+ *              edge is lost. On wake the PLL is restarted and mtime is moved on
+ *              by the time slept.
+ *
+ *              The stats give the sleep residency and the wake-up latency, for
+ *              sizing battery powered variants.
+ * @version     0.1
+ * @date        2022-03-22
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include "stdint.h"
+
+/**
+ * @brief If defined, deep-sleep is used when possible. Needs the 32.768 kHz
+ *        crystal; without it power_init() falls back to sleep only.
+ */
+//#define POWER_DEEPSLEEP
+
+#define POWER_SLEEP_MAX_MS          65      // TIMER5 counts us in 16 bits
+#define POWER_DEEPSLEEP_MIN_MS      10      // Shorter idle periods use sleep
+#define POWER_DEEPSLEEP_WAKE_MS     3       // Time for HXTAL and the PLL to restart
+#define POWER_RTC_HZ                32768   // RTC counter rate, prescaler 0 on LXTAL
+
+typedef struct {
+    uint32_t sleeps;
+    uint32_t deepsleeps;
+    uint64_t awake_us;
+    uint64_t sleep_us;
+    uint64_t deepsleep_us;
+    uint32_t wake_us_max;           // TIMER5 deadline to running again
+    uint32_t deepsleep_wake_us_max; // RTC alarm to running again at full clock
+} power_stats_t;
+
+typedef void (*power_print_t)(const char *line);
+
+void power_init(void);
+uint32_t power_idle(uint32_t budget_ms);
+const power_stats_t *power_stats(void);
+void power_stats_reset(void);
+void power_report(power_print_t print);
+
+#endif /* POWER_H */
@@ -0,0 +1,107 @@
+/**
+ * @file        profile.c
+ * @brief       Region list and report of the cycle counting profiler.
+ * @version     0.1
+ * @date        2022-03-18
+ */
+
+#include "profile.h"
+#include "gd32vf103.h"
+#include "stdio.h"
+
+static profile_region_t *regions;
+static uint64_t start_cycles;
+static uint64_t start_instructions;
+
+/**
+ * @brief       Adds a region to the report. Called by the first PROFILE_END of
+ *              the region; interrupts are held off while the list changes.
+ *
+ * @return      None.
+ */
+void profile_register(profile_region_t *region)
+{
+    uint32_t status = read_csr(mstatus);
+
+    clear_csr(mstatus, MSTATUS_MIE);
+    if (!region->registered) {
+        region->next = regions;
+        regions = region;
+        region->registered = 1;
+    }
+    write_csr(mstatus, status);
+}
+
+/**
+ * @brief       Clears the counters of every region and restarts the total. Also
+ *              makes sure mcycle and minstret are counting.
+ *
+ * @return      None.
+ */
+void profile_reset(void)
+{
+    profile_region_t *region;
+
+    clear_csr(CSR_MCOUNTINHIBIT, 0x5);      // CY and IR
+    for (region = regions; region; region = region->next) {
+        region->calls = 0;
+        region->cycles = 0;
+        region->instructions = 0;
+    }
+    start_cycles = get_cycle_value();
+    start_instructions = get_instret_value();
+}
+
+/**
+ * @brief       Prints one line per region, most cycles first, after a total line:
+ *
+ *              region        calls  kcycles  IPC    %
+ *
+ *              IPC is instructions per cycle and % the share of the cycles since
+ *              profile_reset() (or reset), so idle time is what is left. Compact
+ *              lines fit the 20 columns of the LCD and leave out calls and cycles.
+ *
+ * @param[in]   print: called with every line.
+ * @param[in]   compact: non-zero for "region     % IPC" lines.
+ *
+ * @return      None.
+ */
+void profile_report(profile_print_t print, int compact)
+{
+    profile_region_t *sorted[PROFILE_MAX_REGIONS];
+    profile_region_t *region;
+    char line[PROFILE_LINE_LENGTH];
+    uint64_t total = get_cycle_value() - start_cycles;
+    unsigned total_ipc = total ? (get_instret_value() - start_instructions) * 100 / total : 0;
+    int count = 0, i, j;
+
+    for (region = regions; region && count < PROFILE_MAX_REGIONS; region = region->next) {
+        for (i = count; i > 0 && sorted[i - 1]->cycles < region->cycles; i--)
+            sorted[i] = sorted[i - 1];
+        sorted[i] = region;
+        count++;
+    }
+
+    if (compact) {
+        snprintf(line, sizeof line, "%-10s%4s %4s", "region", "%", "IPC");
+    } else {
+        print("region        calls  kcycles  IPC    %");
+        snprintf(line, sizeof line, "%-12s %6s %8lu %u.%02u %4u", "total", "",
+                 (unsigned long) (total / 1000), total_ipc / 100, total_ipc % 100, 100);
+    }
+    print(line);
+
+    for (j = 0; j < count; j++) {
+        uint64_t cycles = sorted[j]->cycles;
+        unsigned ipc = cycles ? sorted[j]->instructions * 100 / cycles : 0;
+        unsigned share = total ? cycles * 100 / total : 0;
+
+        if (compact)
+            snprintf(line, sizeof line, "%-10.10s%3u%% %u.%02u", sorted[j]->name, share, ipc / 100, ipc % 100);
+        else
+            snprintf(line, sizeof line, "%-12.12s %6lu %8lu %u.%02u %4u", sorted[j]->name,
+                     (unsigned long) sorted[j]->calls, (unsigned long) (cycles / 1000),
+                     ipc / 100, ipc % 100, share);
+        print(line);
+    }
+}
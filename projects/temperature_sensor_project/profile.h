@@ -0,0 +1,92 @@
+/**
+ * @file        profile.h
+ * @brief       Cycle counting profiler. A region is a named static counter
+ *              block; PROFILE_BEGIN/PROFILE_END around a piece of code add the
+ *              mcycle and minstret deltas to it. A probe pair costs four CSR
+ *              reads and a few adds, so the probes can stay in release builds.
+ *              profile_report() prints the regions sorted by cycles.
+ *
+ *              PROFILE_REGION(tile_flush);                 // At file scope
+ *              ...
+ *              PROFILE_BEGIN(tile_flush);
+ *              tile_flush();
+ *              PROFILE_END(tile_flush);
+ *
+ *              A region must only be entered from one context (main loop or
+ *              one interrupt). Regions may nest; the outer one includes the
+ *              inner one.
+ * @version     0.1
+ * @date        2022-03-18
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "stdint.h"
+#include "riscv_encoding.h"
+
+/**
+ * @brief If defined, the probes are compiled in.
+ */
+#define PROFILE
+
+#define PROFILE_MAX_REGIONS     16
+#define PROFILE_LINE_LENGTH     48
+
+typedef struct profile_region {
+    const char *name;
+    uint32_t calls;
+    uint64_t cycles;
+    uint64_t instructions;
+    struct profile_region *next;    // Registered regions, NULL until the first PROFILE_END
+    uint8_t registered;
+} profile_region_t;
+
+/**
+ * @brief Receives one line of the report, without a line ending.
+ */
+typedef void (*profile_print_t)(const char *line);
+
+#ifdef PROFILE
+
+#define PROFILE_REGION(region) \
+    profile_region_t profile_##region = { #region, 0, 0, 0, 0, 0 }
+
+#define PROFILE_BEGIN(region) \
+    uint32_t profile_cycles_##region = read_csr(mcycle); \
+    uint32_t profile_instret_##region = read_csr(minstret)
+
+#define PROFILE_END(region) \
+    profile_account(&profile_##region, \
+                    (uint32_t) read_csr(mcycle) - profile_cycles_##region, \
+                    (uint32_t) read_csr(minstret) - profile_instret_##region)
+
+/**
+ * @brief Counts a call of a region without timing it.
+ */
+#define PROFILE_COUNT(region) profile_account(&profile_##region, 0, 0)
+
+void profile_register(profile_region_t *region);
+
+static inline void profile_account(profile_region_t *region, uint32_t cycles, uint32_t instructions)
+{
+    if (!region->registered)
+        profile_register(region);
+    region->calls++;
+    region->cycles += cycles;
+    region->instructions += instructions;
+}
+
+#else
+
+#define PROFILE_REGION(region)  extern int profile_unused_##region
+#define PROFILE_BEGIN(region)   do { } while (0)
+#define PROFILE_END(region)     do { } while (0)
+#define PROFILE_COUNT(region)   do { } while (0)
+
+#endif /* PROFILE */
+
+void profile_reset(void);
+void profile_report(profile_print_t print, int compact);
+
+#endif /* PROFILE_H */
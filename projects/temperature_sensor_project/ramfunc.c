@@ -0,0 +1,160 @@
+/**
+ * @file        ramfunc.c
+ * @brief       Flash versus SRAM benchmark, see ramfunc.h.
+ * @version     0.1
+ * @date        2022-03-23
+ */
+
+#include "ramfunc.h"
+
+#ifdef RAMFUNC_BENCHMARK
+#include "riscv_encoding.h"
+#include "lcd.h"
+#include "lcd_tile.h"
+#include "ring.h"
+#include <stdio.h>
+
+#define ALWAYS_INLINE   static inline __attribute__( ( always_inline ) )
+
+RING_DEFINE(bench_ring, uint8_t, 256)
+
+static uint16_t pixels[TILE_W * TILE_H];
+static bench_ring_t ring;
+static volatile uint32_t sink;          // Keeps the results alive
+
+/*
+ * The kernels are written once and inlined into a flash and a SRAM copy, so
+ * both run exactly the same instructions.
+ */
+
+/* FNV-1a over a tile, as _hash() in lcd_tile.c */
+ALWAYS_INLINE uint32_t _hash_kernel(void)
+{
+    const uint32_t *words = (const uint32_t *) pixels;
+    uint32_t hash = 2166136261UL;
+    int i;
+
+    for (i = 0; i < TILE_W * TILE_H / 2; i++) {
+        hash ^= words[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+/* Four glyphs expanded to RGB565, as _render() in lcd_tile.c */
+ALWAYS_INLINE uint32_t _glyph_kernel(void)
+{
+    static const char text[] = "21.5";
+    uint16_t *out = pixels;
+    int x, y;
+
+    for (y = 0; y < TILE_FONT_H; y++) {
+        for (x = 0; x < TILE_W; x++) {
+            uint8_t bits = asc2_1608[(text[x / TILE_FONT_W] - ' ') * TILE_FONT_H + y];
+            *out++ = (bits >> (x % TILE_FONT_W)) & 1 ? WHITE : BLACK;
+        }
+    }
+    return pixels[0];
+}
+
+/* A full ring of bytes in and out one at a time, as the USART0 handler does */
+ALWAYS_INLINE uint32_t _ring_kernel(void)
+{
+    uint32_t sum = 0, i;
+    uint8_t byte;
+
+    for (i = 0; i < 256; i++)
+        bench_ring_push(&ring, (uint8_t) i);
+    while (bench_ring_pop(&ring, &byte))
+        sum += byte;
+    return sum;
+}
+
+#define BENCH_PAIR(name) \
+    static __attribute__( ( noinline ) ) uint32_t name##_flash(void) { return name##_kernel(); } \
+    RAMFUNC static __attribute__( ( noinline ) ) uint32_t name##_ram(void) { return name##_kernel(); }
+
+BENCH_PAIR(_hash)
+BENCH_PAIR(_glyph)
+BENCH_PAIR(_ring)
+
+/* The real tile_flush() work, _render() and _hash() of lcd_tile.c, over every
+   tile of the screen on show. They are RAMFUNC, so this runs from wherever the
+   build put them. */
+static uint32_t _tiles(void)
+{
+    uint32_t hash = 0;
+    int tile;
+
+    for (tile = 0; tile < TILE_COUNT; tile++)
+        hash ^= tile_benchmark(tile, pixels);
+    return hash;
+}
+
+/**
+ * @brief       Fewest cycles of RAMFUNC_BENCHMARK_RUNS calls, with interrupts
+ *              off. The first call also warms up the flash prefetch.
+ */
+static uint32_t _time(uint32_t (*kernel)(void))
+{
+    uint32_t status = read_csr(mstatus), best = UINT32_MAX, start, cycles;
+    int run;
+
+    clear_csr(mstatus, MSTATUS_MIE);
+    for (run = 0; run < RAMFUNC_BENCHMARK_RUNS; run++) {
+        start = read_csr(mcycle);
+        sink += kernel();
+        cycles = read_csr(mcycle) - start;
+        if (cycles < best)
+            best = cycles;
+    }
+    write_csr(mstatus, status);
+    return best;
+}
+
+/**
+ * @brief       Times each kernel from flash and from SRAM and prints one line
+ *              per kernel that fits the 20 columns of the LCD. The last line is
+ *              the real tile render and hash, cycles per tile, in the column
+ *              of the build: compare a build without RAMFUNC_ENABLE for the
+ *              other one.
+ *
+ * @param[in]   print: called with every line.
+ *
+ * @return      None.
+ */
+void ramfunc_benchmark(ramfunc_print_t print)
+{
+    static const struct {
+        const char *name;
+        uint32_t (*flash)(void);
+        uint32_t (*ram)(void);
+    } kernels[] = {
+        { "hash",  _hash_flash,  _hash_ram },
+        { "glyph", _glyph_flash, _glyph_ram },
+        { "ring",  _ring_flash,  _ring_ram },
+    };
+    char line[24];
+    uint32_t cycles;
+    unsigned i;
+
+    clear_csr(CSR_MCOUNTINHIBIT, 0x5);      // CY and IR
+    bench_ring_init(&ring);
+    print("cycles  flash   sram");
+    for (i = 0; i < sizeof kernels / sizeof kernels[0]; i++) {
+        uint32_t flash = _time(kernels[i].flash);
+        uint32_t ram = _time(kernels[i].ram);
+        snprintf(line, sizeof line, "%-5s %7lu %6lu", kernels[i].name,
+                 (unsigned long) flash, (unsigned long) ram);
+        print(line);
+    }
+
+    cycles = _time(_tiles) / TILE_COUNT;
+#ifdef RAMFUNC_ENABLE
+    snprintf(line, sizeof line, "%-5s %7s %6lu", "tile", "-", (unsigned long) cycles);
+#else
+    snprintf(line, sizeof line, "%-5s %7lu %6s", "tile", (unsigned long) cycles, "-");
+#endif
+    print(line);
+}
+#endif /* RAMFUNC_BENCHMARK */
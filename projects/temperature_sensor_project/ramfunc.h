@@ -0,0 +1,60 @@
+/**
+ * @file        ramfunc.h
+ * @brief       Code run from SRAM. Functions marked RAMFUNC are linked into the
+ *              .ramfunc section, which start.S copies from flash to SRAM next
+ *              to .data. Flash is read through wait states, so the interrupt
+ *              handlers and the inner loops of the display update are kept
+ *              there:
+ *
+ *                  RAMFUNC static void _u0_service(void)
+ *
+ *              Only the marked function moves. Library functions it calls
+ *              still run from flash, so hot paths use the registers directly
+ *              and the ring.h helpers are always inlined. What runs from SRAM:
+ *              eclicw_dispatch, ds18B20fsm, the USART0 service routine with the
+ *              AT response matcher it calls per byte, the LCD DMA transfer
+ *              complete handler and the tile _render/_hash loops. Callbacks
+ *              run once per event, such as the DS18B20 reading hook and the
+ *              error log, stay in flash, as does lcd_dma_poll() in the main
+ *              loop. RAMFUNC implies noinline, or the body would be copied
+ *              back into a caller in flash.
+ *
+ *              ramfunc_benchmark() times the same kernels from flash and from
+ *              SRAM, then the real tile render and hash in the placement of
+ *              the build. For the interrupt handlers, build with ECLICW_STATS
+ *              with and without RAMFUNC_ENABLE and compare the cycle counts
+ *              in the profile report.
+ * @version     0.1
+ * @date        2022-03-23
+ */
+
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#include "stdint.h"
+
+/**
+ * @brief If defined, RAMFUNC places functions in SRAM, else it is empty.
+ */
+#define RAMFUNC_ENABLE
+
+/**
+ * @brief If defined, ramfunc_benchmark() is built.
+ */
+//#define RAMFUNC_BENCHMARK
+
+#ifdef RAMFUNC_ENABLE
+#define RAMFUNC     __attribute__( ( section( ".ramfunc" ), noinline ) )
+#else
+#define RAMFUNC
+#endif
+
+#define RAMFUNC_BENCHMARK_RUNS  8       // The fastest run is kept
+
+typedef void (*ramfunc_print_t)(const char *line);
+
+#ifdef RAMFUNC_BENCHMARK
+void ramfunc_benchmark(ramfunc_print_t print);
+#endif
+
+#endif /* RAMFUNC_H */
@@ -0,0 +1,144 @@
+/**
+ * @file        ring.h
+ * @brief       Single producer, single consumer ring buffers, generated per
+ *              element type and size:
+ *
+ *                  RING_DEFINE(tx_ring, uint8_t, 256)
+ *                  static tx_ring_t transmit;
+ *
+ *                  tx_ring_push(&transmit, byte);          // producer
+ *                  if (tx_ring_pop(&transmit, &byte)) ...  // consumer
+ *
+ *              The size must be a power of two. head and tail run freely and
+ *              are masked on use, so all size slots can be filled and count is
+ *              simply head - tail. Only the producer writes head and only the
+ *              consumer writes tail, with release stores paired with acquire
+ *              loads, so one side may run in an interrupt without any locks.
+ *
+ *              The span functions hand out the contiguous part of the ring
+ *              that can be written (or read) in place, e.g. by DMA, and commit
+ *              (or release) it afterwards.
+ *
+ *              The functions are always inlined, so code run from SRAM (see
+ *              ramfunc.h) never calls back into a flash copy of them.
+ * @version     0.1
+ * @date        2022-03-20
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include "stdint.h"
+
+#define RING_INLINE     static inline __attribute__( ( always_inline ) )
+
+#define RING_DEFINE(name, type, size) \
+    _Static_assert(((size) & ((size) - 1)) == 0, #name " size must be a power of two"); \
+    typedef struct { \
+        type data[size]; \
+        uint32_t head;                  /* Written by the producer only */ \
+        uint32_t tail;                  /* Written by the consumer only */ \
+    } name##_t; \
+    \
+    RING_INLINE void name##_init(name##_t *ring) \
+    { \
+        ring->head = ring->tail = 0; \
+    } \
+    \
+    /* Number of elements stored, exact for the consumer */ \
+    RING_INLINE uint32_t name##_count(const name##_t *ring) \
+    { \
+        return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - ring->tail; \
+    } \
+    \
+    /* Number of free slots, exact for the producer */ \
+    RING_INLINE uint32_t name##_free(const name##_t *ring) \
+    { \
+        return (size) - (ring->head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)); \
+    } \
+    \
+    /* Contiguous free slots starting at the returned pointer, fill then commit */ \
+    RING_INLINE type *name##_write_span(name##_t *ring, uint32_t *length) \
+    { \
+        uint32_t offset = ring->head & ((size) - 1); \
+        uint32_t free = name##_free(ring); \
+        *length = free < (size) - offset ? free : (size) - offset; \
+        return &ring->data[offset]; \
+    } \
+    \
+    RING_INLINE void name##_write_commit(name##_t *ring, uint32_t length) \
+    { \
+        __atomic_store_n(&ring->head, ring->head + length, __ATOMIC_RELEASE); \
+    } \
+    \
+    /* Contiguous stored elements starting at the returned pointer, use then release */ \
+    RING_INLINE type *name##_read_span(name##_t *ring, uint32_t *length) \
+    { \
+        uint32_t offset = ring->tail & ((size) - 1); \
+        uint32_t count = name##_count(ring); \
+        *length = count < (size) - offset ? count : (size) - offset; \
+        return &ring->data[offset]; \
+    } \
+    \
+    RING_INLINE void name##_read_release(name##_t *ring, uint32_t length) \
+    { \
+        __atomic_store_n(&ring->tail, ring->tail + length, __ATOMIC_RELEASE); \
+    } \
+    \
+    /* Returns 0 if the ring is full */ \
+    RING_INLINE int name##_push(name##_t *ring, type value) \
+    { \
+        if (!name##_free(ring)) \
+            return 0; \
+        ring->data[ring->head & ((size) - 1)] = value; \
+        name##_write_commit(ring, 1); \
+        return 1; \
+    } \
+    \
+    /* Returns 0 if the ring is empty */ \
+    RING_INLINE int name##_pop(name##_t *ring, type *value) \
+    { \
+        if (!name##_count(ring)) \
+            return 0; \
+        *value = ring->data[ring->tail & ((size) - 1)]; \
+        name##_read_release(ring, 1); \
+        return 1; \
+    } \
+    \
+    /* Pushes as many of the values as fit, returns how many */ \
+    RING_INLINE uint32_t name##_push_n(name##_t *ring, const type *values, uint32_t length) \
+    { \
+        uint32_t done = 0, span, i; \
+        while (done < length) { \
+            type *slot = name##_write_span(ring, &span); \
+            if (!span) \
+                break; \
+            if (span > length - done) \
+                span = length - done; \
+            for (i = 0; i < span; i++) \
+                slot[i] = values[done + i]; \
+            name##_write_commit(ring, span); \
+            done += span; \
+        } \
+        return done; \
+    } \
+    \
+    /* Pops up to length values, returns how many */ \
+    RING_INLINE uint32_t name##_pop_n(name##_t *ring, type *values, uint32_t length) \
+    { \
+        uint32_t done = 0, span, i; \
+        while (done < length) { \
+            const type *slot = name##_read_span(ring, &span); \
+            if (!span) \
+                break; \
+            if (span > length - done) \
+                span = length - done; \
+            for (i = 0; i < span; i++) \
+                values[done + i] = slot[i]; \
+            name##_read_release(ring, span); \
+            done += span; \
+        } \
+        return done; \
+    }
+
+#endif /* RING_H */
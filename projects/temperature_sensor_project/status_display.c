@@ -0,0 +1,244 @@
+/**
+ * @file        status_display.c
+ * @brief       The status screen, drawn with the tile renderer.
+ *
+ *              Text page (20x5 characters):
+ *                  WiFi connected
+ *                  Temp      -12.3 C
+ *                  Mean      -12.1 C
+ *                   CHECK
+ *                  rise at 1234 s
+ *
+ *              Chart page (STATUS_DISPLAY_CHART): a scrolling chart of the
+ *              temperature and its mean over the left 128 columns, and a fixed
+ *              column of 4 characters on the right with the state, the
+ *              temperature, the top and bottom of the scale and the connection.
+ * @version     0.1
+ * @date        2022-03-15
+ */
+
+#include "status_display.h"
+#include "lcd_tile.h"
+#include "stdio.h"
+#include "string.h"
+#include "trace.h"
+#include "clock.h"
+
+#ifdef STATUS_DISPLAY_CHART
+#include "lcd_chart.h"
+
+#define STATUS_DISPLAY_CHART_WIDTH  CHART_MAX_WIDTH
+#define STATUS_DISPLAY_VALUE_LENGTH 4
+
+static const uint16_t chart_colors[] = {YELLOW, GRAY};
+static lcd_chart_t chart;
+static temp_q8_t chart_mean = CHART_NO_SAMPLE;
+static int item_scale_high;
+static int item_scale_low;
+#else
+#define STATUS_DISPLAY_VALUE_X  48
+#define STATUS_DISPLAY_VALUE_LENGTH (TEMP_Q8_STRING_LENGTH + 2)    // "-128.0 C"
+#endif
+
+static int item_connection;
+static int item_temperature;
+static int item_mean = -1;
+static int item_status;
+static int item_detail = -1;
+static uint16_t frame_ms;
+
+/**
+ * @brief       Sets a field to a temperature followed by the unit, or in the
+ *              narrow chart column to the temperature alone, in whole degrees
+ *              if the tenths do not fit.
+ */
+static void _set_temperature(int item, temp_q8_t temp)
+{
+    char str[STATUS_DISPLAY_VALUE_LENGTH + 1];
+    char value[TEMP_Q8_STRING_LENGTH];
+
+#ifdef STATUS_DISPLAY_CHART
+    int tenths = temp_q8_to_tenths(temp);
+
+    if (temp_q8_format(value, temp) <= STATUS_DISPLAY_VALUE_LENGTH)
+        sprintf(str, "%4s", value);
+    else
+        sprintf(str, "%4d", (tenths + (tenths < 0 ? -5 : 5)) / 10);
+#else
+    temp_q8_format(value, temp);
+    sprintf(str, "%6s C", value);
+#endif
+    tile_set_text(item, str);
+}
+
+/**
+ * @brief       Builds the status screen. Nothing is sent until the first tick.
+ *
+ * @return      None.
+ */
+void status_display_init(void)
+{
+#ifdef STATUS_DISPLAY_CHART
+    uint8_t x = STATUS_DISPLAY_CHART_WIDTH;
+
+    tile_init(BLACK);
+    tile_set_owned(x, 0, LCD_W - x, LCD_H);
+    item_status = tile_add_text(x, 0, 4, BLACK, GREEN);
+    item_temperature = tile_add_text(x, 16, 4, YELLOW, BLACK);
+    item_scale_high = tile_add_text(x, 32, 4, LGRAY, BLACK);
+    item_scale_low = tile_add_text(x, 48, 4, LGRAY, BLACK);
+    item_connection = tile_add_text(x, 64, 4, WHITE, DARKBLUE);
+    lcd_chart_init(&chart, 0, STATUS_DISPLAY_CHART_WIDTH, 2, chart_colors, BLACK, DGRAY);
+#else
+    int label;
+
+    tile_init(BLACK);
+    item_connection = tile_add_text(0, 0, TILE_TEXT_LENGTH, WHITE, DARKBLUE);
+    label = tile_add_text(0, 16, 4, LGRAY, BLACK);
+    tile_set_text(label, "Temp");
+    item_temperature = tile_add_text(STATUS_DISPLAY_VALUE_X, 16, STATUS_DISPLAY_VALUE_LENGTH, WHITE, BLACK);
+    label = tile_add_text(0, 32, 4, LGRAY, BLACK);
+    tile_set_text(label, "Mean");
+    item_mean = tile_add_text(STATUS_DISPLAY_VALUE_X, 32, STATUS_DISPLAY_VALUE_LENGTH, WHITE, BLACK);
+    item_status = tile_add_text(0, 48, TILE_TEXT_LENGTH, BLACK, GREEN);
+    item_detail = tile_add_text(0, 64, TILE_TEXT_LENGTH, LGRAY, BLACK);
+#endif
+
+    status_display_set_connection(0);
+    status_display_set_status(1, "");
+    frame_ms = 0;
+}
+
+/**
+ * @brief       Shows whether the device is connected to the broker.
+ *
+ * @return      None.
+ */
+void status_display_set_connection(int connected)
+{
+#ifdef STATUS_DISPLAY_CHART
+    tile_set_text(item_connection, connected ? "WiFi" : "----");
+#else
+    tile_set_text(item_connection, connected ? "WiFi connected" : "WiFi offline");
+#endif
+}
+
+/**
+ * @brief       Shows the latest temperature reading. On the chart page this
+ *              also adds a column, with the mean last passed to
+ *              status_display_set_mean().
+ *
+ * @return      None.
+ */
+void status_display_set_temperature(temp_q8_t temp)
+{
+    _set_temperature(item_temperature, temp);
+#ifdef STATUS_DISPLAY_CHART
+    temp_q8_t values[] = {temp, chart_mean};
+    lcd_chart_push(&chart, values);
+#endif
+}
+
+/**
+ * @brief       Shows the mean temperature.
+ *
+ * @return      None.
+ */
+void status_display_set_mean(temp_q8_t mean)
+{
+#ifdef STATUS_DISPLAY_CHART
+    chart_mean = mean;
+#endif
+    if (item_mean >= 0)
+        _set_temperature(item_mean, mean);
+}
+
+/**
+ * @brief       Shows the OK/CHECK state, highlighted, with a line of detail.
+ *
+ * @param[in]   ok: non-zero if the temperature is in control.
+ * @param[in]   detail: e.g. what triggered the last transition.
+ *
+ * @return      None.
+ */
+void status_display_set_status(int ok, const char *detail)
+{
+#ifdef STATUS_DISPLAY_CHART
+    tile_set_text(item_status, ok ? " OK" : "CHK");
+#else
+    tile_set_text(item_status, ok ? " OK" : " CHECK");
+#endif
+    tile_set_colors(item_status, ok ? BLACK : WHITE, ok ? GREEN : RED);
+    tile_set_text(item_detail, detail);
+}
+
+/**
+ * @brief       Hands the screen over, e.g. to a debug report, until
+ *              status_display_redraw(). Stop calling status_display_tick()
+ *              meanwhile.
+ *
+ * @return      None.
+ */
+void status_display_suspend(void)
+{
+#ifdef STATUS_DISPLAY_CHART
+    lcd_chart_close(&chart);
+#endif
+}
+
+/**
+ * @brief       Takes the screen back and sends all of it on the next frame.
+ *
+ * @return      None.
+ */
+void status_display_redraw(void)
+{
+    LCD_Clear(BLACK);
+    tile_invalidate_all();
+#ifdef STATUS_DISPLAY_CHART
+    lcd_chart_redraw(&chart);
+#endif
+}
+
+/**
+ * @return      Calls of status_display_tick() until the next frame is drawn,
+ *              1 while the LCD is still powering up.
+ */
+uint32_t status_display_idle_ms(void)
+{
+    if (!LCD_Ready() || frame_ms >= STATUS_DISPLAY_FRAME_MS)
+        return 1;
+    return STATUS_DISPLAY_FRAME_MS - frame_ms;
+}
+
+/**
+ * @brief       Redraws the changed parts of the screen every
+ *              STATUS_DISPLAY_FRAME_MS. Call once per millisecond.
+ *              Nothing is drawn until the LCD has powered up.
+ *
+ * @return      None.
+ */
+void status_display_tick(void)
+{
+    if (++frame_ms < STATUS_DISPLAY_FRAME_MS || !LCD_Ready())
+        return;
+    frame_ms = 0;
+    clock_burst_begin();                // Render at full speed, idle clock once sent
+    TRACE_BEGIN(TRACE_LCD_FRAME, 0);
+#ifdef STATUS_DISPLAY_CHART
+    {
+        char str[STATUS_DISPLAY_VALUE_LENGTH + 1];
+        temp_q8_t low, high;
+
+        lcd_chart_flush(&chart);
+        lcd_chart_scale(&chart, &low, &high);
+        sprintf(str, "%4d", temp_q8_to_tenths(high) / 10);
+        tile_set_text(item_scale_high, str);
+        sprintf(str, "%4d", temp_q8_to_tenths(low) / 10);
+        tile_set_text(item_scale_low, str);
+    }
+#endif
+    tile_flush();
+    TRACE_END(TRACE_LCD_FRAME, 0);
+    clock_burst_end();
+}
@@ -0,0 +1,35 @@
+/**
+ * @file        status_display.h
+ * @brief       The status screen: connection state, current and mean
+ *              temperature, and the OK/CHECK state of the refrigerator.
+ *              Setters only update the retained screen and are called from
+ *              the main loop (temp_sensor_poll()); status_display_tick()
+ *              redraws the changed tiles at a fixed frame rate.
+ * @version     0.1
+ * @date        2022-03-15
+ */
+
+#ifndef STATUS_DISPLAY_H
+#define STATUS_DISPLAY_H
+
+#include "temp_fixed.h"
+#include "stdint.h"
+
+//#define STATUS_DISPLAY_CHART  // Uncomment for the trend chart page instead of the text page
+
+/**
+ * @brief Milliseconds between frames (10 fps).
+ */
+#define STATUS_DISPLAY_FRAME_MS 100
+
+void status_display_init(void);
+void status_display_set_connection(int connected);
+void status_display_set_temperature(temp_q8_t temp);
+void status_display_set_mean(temp_q8_t mean);
+void status_display_set_status(int ok, const char *detail);
+void status_display_tick(void);
+void status_display_suspend(void);
+void status_display_redraw(void);
+uint32_t status_display_idle_ms(void);
+
+#endif /* STATUS_DISPLAY_H */
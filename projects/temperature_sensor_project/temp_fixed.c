@@ -0,0 +1,91 @@
+/**
+ * @file        temp_fixed.c
+ * @brief       Conversion and formatting of signed fixed-point temperatures.
+ * @version     0.1
+ * @date        2022-03-09
+ */
+
+#include "temp_fixed.h"
+#include <stdio.h>
+
+/**
+ * @brief       Widens a Q11.4 temperature to Q7.8. The DS18B20 range 
+ *              (-55 to +125 °C) fits without saturation.
+ *
+ * @param[in]   temp: the Q11.4 temperature.
+ *
+ * @return      the Q7.8 temperature.
+ */
+temp_q8_t temp_q4_to_q8(temp_q4_t temp)
+{
+    return (temp_q8_t) (temp * (1 << (TEMP_Q8_FRAC_BITS - TEMP_Q4_FRAC_BITS)));
+}
+
+/**
+ * @brief       Narrows a Q7.8 temperature to Q11.4, rounding half away from zero.
+ *
+ * @param[in]   temp: the Q7.8 temperature.
+ *
+ * @return      the Q11.4 temperature.
+ */
+temp_q4_t temp_q8_to_q4(temp_q8_t temp)
+{
+    /* Same rounding as a Q7.8 narrowing with TEMP_Q8_FRAC_BITS - TEMP_Q4_FRAC_BITS extra bits */
+    return temp_q8_round(temp, 2 * TEMP_Q8_FRAC_BITS - TEMP_Q4_FRAC_BITS);
+}
+
+/**
+ * @brief       Narrows a fixed-point value with more fraction bits to Q7.8, 
+ *              rounding half away from zero and saturating to the Q7.8 range.
+ *
+ * @param[in]   value: the value to narrow.
+ * @param[in]   frac_bits: number of fraction bits in value (at least TEMP_Q8_FRAC_BITS).
+ *
+ * @return      the Q7.8 temperature.
+ */
+temp_q8_t temp_q8_round(int32_t value, uint8_t frac_bits)
+{
+    uint8_t shift = frac_bits - TEMP_Q8_FRAC_BITS;
+    int64_t half = shift ? 1 << (shift - 1) : 0;
+    int64_t rounded = value < 0 ? -((-(int64_t) value + half) >> shift) : (value + half) >> shift;  // No overflow at the ends
+
+    if (rounded > INT16_MAX)
+        return INT16_MAX;
+    if (rounded < INT16_MIN)
+        return INT16_MIN;
+    return (temp_q8_t) rounded;
+}
+
+/**
+ * @brief       Converts a Q7.8 temperature to tenths of a degree, rounding 
+ *              half away from zero (e.g. -0.5 °C becomes -5).
+ *
+ * @param[in]   temp: the Q7.8 temperature.
+ *
+ * @return      the temperature in tenths of a degree.
+ */
+int temp_q8_to_tenths(temp_q8_t temp)
+{
+    int32_t scaled = (int32_t) temp * 10;
+    int32_t half = 1 << (TEMP_Q8_FRAC_BITS - 1);
+
+    if (scaled < 0)
+        return -((-scaled + half) >> TEMP_Q8_FRAC_BITS);
+    return (scaled + half) >> TEMP_Q8_FRAC_BITS;
+}
+
+/**
+ * @brief       Formats a Q7.8 temperature with one decimal, e.g. "-18.5".
+ *
+ * @param[out]  string: buffer of at least TEMP_Q8_STRING_LENGTH characters.
+ * @param[in]   temp: the Q7.8 temperature.
+ *
+ * @return      the length of the formatted string.
+ */
+int temp_q8_format(char *string, temp_q8_t temp)
+{
+    int tenths = temp_q8_to_tenths(temp);
+    int magnitude = tenths < 0 ? -tenths : tenths;
+
+    return sprintf(string, "%s%d.%d", tenths < 0 ? "-" : "", magnitude / 10, magnitude % 10);
+}
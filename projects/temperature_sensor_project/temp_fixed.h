@@ -0,0 +1,45 @@
+/**
+ * @file        temp_fixed.h
+ * @brief       Signed fixed-point temperature formats used from the sensor to 
+ *              the statistics, MQTT and the LCD.
+ *
+ *              Q11.4: the native DS18B20 format (SSSS SIII IIII FFFF), 1/16 °C.
+ *              Q7.8:  the working format, 1/256 °C, range -128 to +127.99 °C.
+ * @version     0.1
+ * @date        2022-03-09
+ */
+
+#ifndef TEMP_FIXED_H
+#define TEMP_FIXED_H
+
+#include "stdint.h"
+
+typedef int16_t temp_q4_t;
+typedef int16_t temp_q8_t;
+
+#define TEMP_Q4_FRAC_BITS 4
+#define TEMP_Q8_FRAC_BITS 8
+
+/**
+ * @brief Sign extends the 16 bit DS18B20 conversion to Q11.4.
+ */
+#define TEMP_Q4_FROM_RAW(raw)       ((temp_q4_t) (int16_t) ((raw) & 0xFFFF))
+
+/**
+ * @brief Q7.8 constants from whole degrees or tenths of degrees, rounded half away from zero.
+ */
+#define TEMP_Q8_FROM_INT(deg)       ((temp_q8_t) ((deg) * (1 << TEMP_Q8_FRAC_BITS)))
+#define TEMP_Q8_FROM_TENTHS(t)      ((temp_q8_t) (((t) * (1 << TEMP_Q8_FRAC_BITS) + ((t) < 0 ? -5 : 5)) / 10))
+
+/**
+ * @brief Longest string produced by temp_q8_format(), including the terminator ("-128.0").
+ */
+#define TEMP_Q8_STRING_LENGTH 7
+
+temp_q8_t temp_q4_to_q8(temp_q4_t temp);
+temp_q4_t temp_q8_to_q4(temp_q8_t temp);
+temp_q8_t temp_q8_round(int32_t value, uint8_t frac_bits);
+int temp_q8_to_tenths(temp_q8_t temp);
+int temp_q8_format(char *string, temp_q8_t temp);
+
+#endif /* TEMP_FIXED_H */
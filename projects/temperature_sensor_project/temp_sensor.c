@@ -1,25 +1,60 @@
 #include "temp_sensor.h"
+#include "temp_stats.h"
+#include "temp_fixed.h"
+#include "change_detect.h"
+#include "ts_codec.h"
 #include "stdbool.h"
 #include "mqtt.h"
+#include "status_display.h"
+#include "profile.h"
+#include "trace.h"
+#include "logger.h"
+#include "pool.h"
+#include "ring.h"
 
 //#define SIMULATE_TEMP // comment this out to read the real temperature from the sensor
 #define DEBUG_MQTT_TEMP
 
+#define MAX_READINGS 10             // Samples between status reports when nothing changes
+#define TEMP_EWMA_ALPHA TEMP_STATS_ALPHA(1, 4)
+#define TEMP_BATCH_READINGS 64      // Readings per binary batch publish
+#define TEMP_BATCH_BYTES 128        // Payload buffer, ~1 byte per reading for a steady signal
+#define TEMP_QUEUE_READINGS 4       // Readings waiting for temp_sensor_poll(), a power of two
+
 #ifdef SIMULATE_TEMP
 #include "temp_simulation.h"
-#define STATES 3
-static bool fridge_door_states[STATES] = { // For each run, if the fridge door is open (TRUE) or closed (FALSE)
-    false, false, true 
-};
-static u32 simulation_run = 0;
+#define SIMULATION_SEED 1           // Same seed, same readings
+static sim_sensor_t simulated_sensor;
+#endif
+
+static temp_stats_t temp_stats;
+static const change_detect_config_t temp_detect_config = CHANGE_DETECT_DEFAULT_CONFIG;
+static change_detect_t temp_detector;
+static TEMPERATURE_STATUS temp_status = TEMP_OK;
+static uint32_t temp_samples_since_report = 0;
+static uint8_t temp_batch_buffer[TEMP_BATCH_BYTES];
+static ts_encoder_t temp_batch;
+PROFILE_REGION(sensor);
+
+typedef struct {
+    unsigned int raw;
+    uint32_t timestamp_ms;
+} temp_reading_t;
+
+RING_DEFINE(temp_reading_ring, temp_reading_t, TEMP_QUEUE_READINGS)
+static temp_reading_ring_t temp_readings;
+
+#ifdef TRACE_PUBLISH
+#define TRACE_PACKET_BYTES (TRACE_HEADER_BYTES + 120 * TRACE_EVENT_BYTES)
+static uint32_t trace_readings = 0;
 #endif
 
-#define MAX_READINGS 10 
-#define TEMP_DEVIATION_LIMIT -5
+#ifdef LOG_PUBLISH
+#define LOG_PACKET_BYTES (LOG_HEADER_BYTES + 4 * LOG_WORDS)
+static uint32_t log_readings = 0;
+#endif
 
-static u16 temp_readings[MAX_READINGS];
-static u16 temp_index = 0;
-static u16 temp_normal_avg;    // The "normal" avg. temp. calculated in the initialization procedure
+static void _process_reading(unsigned int temp, uint32_t timestamp_ms);
 
 /**
  * @brief       Initializes the temperature sensor.
@@ -28,13 +63,21 @@ static u16 temp_normal_avg;    // The "normal" avg. temp. calculated in the init
  */
 void temp_sensor_init()
 {
+    temp_stats_init(&temp_stats, TEMP_EWMA_ALPHA);
+    change_detect_init(&temp_detector, &temp_detect_config);
+    ts_encoder_init(&temp_batch, temp_batch_buffer, sizeof temp_batch_buffer);
+    temp_reading_ring_init(&temp_readings);
+#ifdef SIMULATE_TEMP
+    simulate_sensor_init_scenario(&simulated_sensor, &simulate_scenario_refrigerator, SIMULATION_SEED);
+#endif
     ds18B20init(&temp_sensor_callback);
 }
 
 /**
- * @brief       This function gets called whenever there's a new temperature reading.
- *              It will calculate sample averages and notify the user if unwanted 
- *              fluctuation has been detected.
+ * @brief       This function gets called whenever there's a new temperature reading,
+ *              from the DS18B20 timer interrupt. It only queues the reading with its
+ *              time stamp: publishing waits for the responses of the WiFi module,
+ *              so temp_sensor_poll() processes the readings in the main loop.
  * 
  * @param[in]   temp: 16 bit temperature conversion value. The bit format of the 
  *              conversion is SSSS SIII IIII FFFF where S are sign bits, 
@@ -45,99 +88,174 @@ void temp_sensor_init()
  */
 void temp_sensor_callback(unsigned int temp) 
 {
-    // Get the I bits (integer value)
-    u16 temp_integer;
+    temp_reading_t reading = { temp, ds18B20ms() };
 
-#ifdef SIMULATE_TEMP
-    if(fridge_door_states[simulation_run] == TRUE) {
-        temp_integer = simulate_temp_reading_cold();
-    } else {
-        temp_integer = simulate_temp_reading_normal();
+    temp_reading_ring_push(&temp_readings, reading);   // Dropped if the main loop is stuck
+}
+
+/**
+ * @brief       Processes the queued readings and publishes the trace and the log
+ *              when they are due.
+ *              Call from the main loop.
+ *
+ * @return      None.
+ */
+void temp_sensor_poll()
+{
+    temp_reading_t reading;
+
+    while(temp_reading_ring_pop(&temp_readings, &reading))
+        _process_reading(reading.raw, reading.timestamp_ms);
+
+#ifdef TRACE_PUBLISH
+    if(trace_readings >= TRACE_PUBLISH_READINGS) {
+        uint8_t *trace_packet = pool_alloc(TRACE_PACKET_BYTES);
+        if(trace_packet) {
+            uint32_t length = trace_drain(trace_packet, TRACE_PACKET_BYTES);
+            mqtt_send_message_raw(MQTT_SUBTOPIC_TRACE_REFRIGERATOR_1, trace_packet, length);
+            pool_free(trace_packet);
+        }
+        trace_readings = 0;
+    }
+#endif
+
+#ifdef LOG_PUBLISH
+    if(log_readings >= LOG_PUBLISH_READINGS) {
+        uint8_t *log_packet = pool_alloc(LOG_PACKET_BYTES);
+        if(log_packet) {
+            uint32_t length = logger_drain(log_packet, LOG_PACKET_BYTES);
+            mqtt_send_message_raw(MQTT_SUBTOPIC_LOG_REFRIGERATOR_1, log_packet, length);
+            pool_free(log_packet);
+        }
+        log_readings = 0;
     }
+#endif
+}
+
+/**
+ * @brief       Updates the running statistics with a reading and runs it through the
+ *              change-point detector, so the user is notified as soon as a change is
+ *              detected.
+ *
+ * @param[in]   temp: the conversion value passed to temp_sensor_callback().
+ * @param[in]   timestamp_ms: when the reading was taken.
+ *
+ * @return      None.
+ */
+static void _process_reading(unsigned int temp, uint32_t timestamp_ms)
+{
+    // Keep the sign and all four fraction bits
+    temp_q8_t temp_q8;
+
+#ifdef SIMULATE_TEMP
+    // The DS18B20 state machine still paces the readings
+    if(!simulate_sensor_read(&simulated_sensor, timestamp_ms, &temp_q8))
+        return;
 #else
-    temp_integer = temp >> 4;
+    temp_q8 = temp_q4_to_q8(TEMP_Q4_FROM_RAW(temp));
 #endif
 
-    temp_readings[temp_index++] = temp_integer;
+    TRACE_INSTANT(TRACE_SENSOR_SAMPLE, (uint16_t) temp_q8);
+    PROFILE_BEGIN(sensor);
+    temp_stats_update(&temp_stats, temp_q8);
+    status_display_set_mean(temp_q8_round(temp_stats_window_mean(&temp_stats),
+                                          TEMP_Q8_FRAC_BITS + TEMP_STATS_FRAC_BITS));
+    status_display_set_temperature(temp_q8);
 
 #ifdef DEBUG_MQTT_TEMP
-    // Get the F bits (fraction) (right now we don't care about the fraction)
-    u16 temp_sixteenths = temp & 0x000F;
+    mqtt_send_message_temperature(MQTT_SUBTOPIC_TEMP_DEBUG_REFRIGERATOR_1, temp_q8);
+#endif
+
+    _batch_temp(temp_q8, timestamp_ms);
+
+    TEMPERATURE_STATUS status = _check_temp(temp_q8, timestamp_ms);
+    PROFILE_END(sensor);
 
-    // Save one decimal
-    u16 temp_fraction = (temp_sixteenths * 625) / 1000;
+#ifdef TRACE_PUBLISH
+    trace_readings++;
+#endif
 
-    mqtt_send_message_one_decimal(MQTT_SUBTOPIC_TEMP_DEBUG_REFRIGERATOR_1, temp_integer, temp_fraction);
+#ifdef LOG_PUBLISH
+    log_readings++;
 #endif
 
-    if(temp_index >= MAX_READINGS) {
-        
-        if(_check_temp() == TEMP_OK) {
+    /* Nothing to report while the detector learns the reference */
+    if(temp_stats.count < temp_detect_config.warmup)
+        return;
+
+    /* Report immediately on a change, otherwise every MAX_READINGS samples */
+    if(status != temp_status || ++temp_samples_since_report >= MAX_READINGS) {
+        if(status == TEMP_OK) {
             mqtt_send_message_string(MQTT_SUBTOPIC_REFRIGERATOR_1, MQTT_MSG_CONTENT_OK);
         } else {
             mqtt_send_message_string(MQTT_SUBTOPIC_REFRIGERATOR_1, MQTT_MSG_CONTENT_CHECK);
         }
 
-        /* Start reading new samples */
-        temp_index = 0;
-
-#ifdef SIMULATE_TEMP
-        simulation_run = (simulation_run + 1) % STATES;
+#ifdef DEBUG_MQTT_TEMP
+        char str[40] = {0};
+        char mean[TEMP_Q8_STRING_LENGTH] = {0};
+        char baseline[TEMP_Q8_STRING_LENGTH] = {0};
+        temp_q8_format(mean, temp_q8_round(temp_stats_window_mean(&temp_stats), 
+                                           TEMP_Q8_FRAC_BITS + TEMP_STATS_FRAC_BITS));
+        temp_q8_format(baseline, change_detect_reference(&temp_detector));
+        sprintf(str, "mean: %s baseline: %s", mean, baseline);
+        mqtt_send_message_string("home/debugging", str);
 #endif
+
+        temp_status = status;
+        temp_samples_since_report = 0;
     }
 }
 
 /**
- * @brief       Calculates a new sample average, compares this to the normal sample 
- *              average, and then returns the result of the comparison. The first time this
- *              function is called it will set the temp. normal avg. to the calculated sample avg.
+ * @brief       Feeds a new sample through the change-point detector. Transitions
+ *              (OK -> CHECK and back) are published with the time they were 
+ *              detected and what triggered them.
  * 
- * @return      TEMP_OK if no fluctuation has been detected, otherwise TEMP_WARNING
+ * @param[in]   sample: the new temperature sample in Q7.8.
+ * @param[in]   timestamp_ms: when the sample was taken.
+ *
+ * @return      TEMP_OK if no change has been detected, otherwise TEMP_WARNING
  *              will be returned.
  */
-TEMPERATURE_STATUS _check_temp()
+TEMPERATURE_STATUS _check_temp(temp_q8_t sample, uint32_t timestamp_ms)
 {
-    static bool temp_initialized = false;
+    static const char *causes[] = {"none", "rise", "drop", "rate"};
+    change_detect_event_t event;
 
-    /* Calculate new sample average */
-    u16 temp_sample_avg = 0;
-    for(int i = 0; i < MAX_READINGS; i++) {
-        temp_sample_avg += temp_readings[i];
-    }
-    temp_sample_avg /= MAX_READINGS;
-
-#ifdef DEBUG_MQTT_TEMP
-    char str[30] = {0};
-    sprintf(str, "sample_avg: %d", temp_sample_avg);
-    mqtt_send_message_string("home/debugging", str);
-#endif
+    if(change_detect_update(&temp_detector, sample, timestamp_ms, &event)) {
+        char str[40] = {0};
+        sprintf(str, "%s,%s,%lu", event.status == CHANGE_DETECT_OK ? MQTT_MSG_CONTENT_OK : MQTT_MSG_CONTENT_CHECK,
+                causes[event.cause], (unsigned long) event.timestamp_ms);
+        mqtt_send_message_string(MQTT_SUBTOPIC_EVENT_REFRIGERATOR_1, str);
+        LOG_INFO("change detector: status %d cause %d at %d q8 (%u ms)",
+                 event.status, event.cause, sample, event.timestamp_ms);
 
-    if(temp_initialized == true) {
-        /* We will multiply by 100 to get better precision when dividing */
-        /* Just remember that were counting in hundreds */
-        uint16_t temp_sample_avg_fp = temp_sample_avg * 100; 
+        sprintf(str, "%s at %lu s", causes[event.cause], (unsigned long) event.timestamp_ms / 1000);
+        status_display_set_status(event.status == CHANGE_DETECT_OK, str);
+    }
 
-        /* Calculate how much the new avg. deviates from the old avg. in percentage */
-        /* A drop in temperature will result in negative deviation */
-        int32_t deviation = (100 - (temp_sample_avg_fp / temp_normal_avg)) * -1; 
+    return temp_detector.status == CHANGE_DETECT_OK ? TEMP_OK : TEMP_WARNING;
+}
 
-#ifdef DEBUG_MQTT_TEMP
-        sprintf(str, "deviation: %d", deviation);
-        mqtt_send_message_string("home/debugging", str);
-#endif
+/**
+ * @brief       Adds a sample to the current batch and publishes the batch as one 
+ *              binary MQTT message (see ts_codec.h) when it is full.
+ * 
+ * @param[in]   sample: the new temperature sample in Q7.8.
+ * @param[in]   timestamp_ms: when the sample was taken.
+ *
+ * @return      None.
+ */
+void _batch_temp(temp_q8_t sample, uint32_t timestamp_ms)
+{
+    /* The sensor resolution is 1/16 degree, so Q11.4 loses nothing */
+    temp_q4_t sample_q4 = temp_q8_to_q4(sample);
 
-        // If the new average deviates by TEMP_DEVIATION_LIMIT, we send a warning
-        if(deviation < TEMP_DEVIATION_WARNING) {
-            return TEMP_WARNING;
-        }
-    } else {
-#ifdef DEBUG_MQTT_TEMP
-        sprintf(str, "temp. sensor intialization complete");
-        mqtt_send_message_string("home/debugging", str);
-#endif
-        temp_normal_avg = temp_sample_avg;
-        temp_initialized = TRUE;
-    }
+    if(temp_batch.count < TEMP_BATCH_READINGS && ts_encoder_add(&temp_batch, timestamp_ms, sample_q4))
+        return;
 
-    return TEMP_OK;
+    mqtt_send_message_raw(MQTT_SUBTOPIC_BATCH_REFRIGERATOR_1, temp_batch_buffer, ts_encoder_finish(&temp_batch));
+    ts_encoder_init(&temp_batch, temp_batch_buffer, sizeof temp_batch_buffer);
+    ts_encoder_add(&temp_batch, timestamp_ms, sample_q4);
 }
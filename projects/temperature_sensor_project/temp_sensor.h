@@ -2,7 +2,7 @@
  * @file        temp_sensor.h
  * @author      Kim Lintu 
  * @brief       Contains the callback for temperature conversions of the 
- *              DS18B20 thermometer
+ *              DS18B20 thermometer and the processing of the readings
  * @version     1.0
  * @date        2022-02-24
  */
@@ -13,6 +13,7 @@
 #include "ds18b20.h"
 #include "stdlib.h"	
 #include "lcd.h"
+#include "temp_fixed.h"
 
 typedef enum {
     TEMP_OK,             // Temp. is OK
@@ -22,6 +23,8 @@ typedef enum {
 
 void temp_sensor_init();
 void temp_sensor_callback(unsigned int temp);
-TEMPERATURE_STATUS _check_temp();
+void temp_sensor_poll();
+TEMPERATURE_STATUS _check_temp(temp_q8_t sample, uint32_t timestamp_ms);
+void _batch_temp(temp_q8_t sample, uint32_t timestamp_ms);
 
 #endif 
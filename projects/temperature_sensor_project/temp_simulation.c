@@ -1,42 +1,200 @@
+/**
+ * @file        temp_simulation.c
+ * @brief       Deterministic simulation of temperature sensors, see temp_simulation.h.
+ * @version     0.2
+ * @date        2022-03-12
+ */
+
 #include "temp_simulation.h"
-#include "stdlib.h"
-#include "stdbool.h"
-#include "stdint.h"
+
+#define SIM_EXTRA_FRAC_BITS 8
+
+/**
+ * @brief The door is opened for 30 s every 5 minutes and the refrigerator defrosts
+ *        for 10 minutes every 6 hours. Cold air spills on the sensor when the door
+ *        is open (like the old 23-26 / 10-15 degree simulation).
+ */
+static const sim_event_t refrigerator_events[] = {
+    { .type = SIM_EVENT_DOOR_OPEN, .start_ms = 120000, .duration_ms = 30000, .period_ms = 300000,
+      .magnitude = TEMP_Q8_FROM_INT(-11) },
+    { .type = SIM_EVENT_DEFROST, .start_ms = 3600000, .duration_ms = 600000, .period_ms = 21600000,
+      .magnitude = TEMP_Q8_FROM_INT(2) },
+};
+
+const sim_scenario_t simulate_scenario_refrigerator = {
+    .setpoint = TEMP_Q8_FROM_TENTHS(245),
+    .response = 20,
+    .noise = SIM_NOISE_GAUSSIAN,
+    .noise_amplitude = TEMP_Q8_FROM_TENTHS(1),
+    .events = refrigerator_events,
+    .event_count = sizeof refrigerator_events / sizeof refrigerator_events[0],
+};
 
 /**
- * @brief       Generates a random temperature.
+ * @brief       Next number from the sensor's own xorshift32 generator, so sensors
+ *              are reproducible and independent of each other and of rand().
  *
- * @param[in]   min_temp: the lowest possible temperature that should be generated.
+ * @param[out]  sensor: the virtual sensor.
  *
- * @param[in]   max_temp: the highest possible temperature that should be generated.
+ * @return      a pseudo random 32 bit number.
+ */
+uint32_t simulate_random(sim_sensor_t *sensor)
+{
+    uint32_t x = sensor->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sensor->rng = x;
+    return x;
+}
+
+/**
+ * @return      a random number in [-amplitude, amplitude].
+ */
+static int32_t _uniform(sim_sensor_t *sensor, int32_t amplitude)
+{
+    return (int32_t) (simulate_random(sensor) % (uint32_t) (2 * amplitude + 1)) - amplitude;
+}
+
+static int32_t _noise(sim_sensor_t *sensor)
+{
+    const sim_scenario_t *scenario = sensor->scenario;
+    int32_t amplitude = scenario->noise_amplitude;
+    int32_t noise;
+
+    if (amplitude <= 0)
+        return 0;
+
+    switch (scenario->noise) {
+        case SIM_NOISE_UNIFORM:
+            return _uniform(sensor, amplitude);
+        case SIM_NOISE_GAUSSIAN:
+        case SIM_NOISE_SPIKES:
+            /* Sum of four uniforms in +-amplitude/2 has a std. dev. of ~amplitude/2 */
+            noise = 0;
+            for (int i = 0; i < 4; i++)
+                noise += _uniform(sensor, amplitude / 2);
+            if (scenario->noise == SIM_NOISE_SPIKES && (simulate_random(sensor) & 0xFF) == 0)
+                noise += 8 * amplitude;
+            return noise;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @return      true if the event is active at timestamp_ms.
+ */
+static bool _event_active(const sim_event_t *event, uint32_t timestamp_ms)
+{
+    if (timestamp_ms < event->start_ms)
+        return false;
+
+    uint32_t elapsed_ms = timestamp_ms - event->start_ms;
+    if (event->period_ms)
+        elapsed_ms %= event->period_ms;
+    return elapsed_ms < event->duration_ms;
+}
+
+/**
+ * @brief       Sets up a virtual sensor that runs a scenario.
+ *
+ * @param[out]  sensor: the virtual sensor.
+ * @param[in]   scenario: the scenario, must outlive the sensor.
+ * @param[in]   seed: the same seed gives the same readings.
  *
- * @return      the generated temperature.
+ * @return      None.
  */
-uint16_t simulate_rand_temp(uint32_t min_temp, uint32_t max_temp)
+void simulate_sensor_init_scenario(sim_sensor_t *sensor, const sim_scenario_t *scenario, uint32_t seed)
 {
-    return ((float)((float)rand() / RAND_MAX) * (max_temp + 1 - min_temp)) + min_temp;
+    sensor->mode = SIM_MODE_SCENARIO;
+    sensor->scenario = scenario;
+    sensor->trace = 0;
+    sensor->trace_length = 0;
+    sensor->trace_index = 0;
+    sensor->rng = seed ? seed : 0x9E3779B9;
+    sensor->temp = (int32_t) scenario->setpoint * (1 << SIM_EXTRA_FRAC_BITS);
+    sensor->previous_ms = 0;
+    sensor->active_events = 0;
 }
 
 /**
- * @brief   Simulates a "normal" temp. reading, e.g. when the fridge door is closed.
+ * @brief       Sets up a virtual sensor that replays a recorded trace.
+ *
+ * @param[out]  sensor: the virtual sensor.
+ * @param[in]   trace: the samples ordered by timestamp, must outlive the sensor.
+ * @param[in]   length: number of samples in the trace.
  *
- * @return  the simulated temp. reading.
+ * @return      None.
  */
-uint16_t simulate_temp_reading_normal()
+void simulate_sensor_init_trace(sim_sensor_t *sensor, const sim_trace_point_t *trace, uint32_t length)
 {
-    uint16_t temp = simulate_rand_temp(23, 26);
-    
-    return temp;
+    sensor->mode = SIM_MODE_TRACE;
+    sensor->scenario = 0;
+    sensor->trace = trace;
+    sensor->trace_length = length;
+    sensor->trace_index = 0;
+    sensor->rng = 1;
+    sensor->temp = 0;
+    sensor->previous_ms = 0;
+    sensor->active_events = 0;
 }
 
 /**
- * @brief   Simulates a "cold" temp. reading, e.g. when the fridge door is open.
+ * @brief       Reads a virtual sensor. The result is quantized to the 1/16 degree
+ *              resolution of the DS18B20.
  *
- * @return  the simulated temp. reading.
+ * @param[out]  sensor: the virtual sensor.
+ * @param[in]   timestamp_ms: time of the reading, must not go backwards.
+ * @param[out]  temp: the reading in Q7.8.
+ *
+ * @return      false if there is no reading (dropout, or trace not started yet).
  */
-uint16_t simulate_temp_reading_cold()
+bool simulate_sensor_read(sim_sensor_t *sensor, uint32_t timestamp_ms, temp_q8_t *temp)
 {
-    uint16_t temp = simulate_rand_temp(10, 15);
-    
-    return temp;
+    if (sensor->mode == SIM_MODE_TRACE) {
+        /* Hold the latest sample at or before timestamp_ms, looping at the end */
+        if (!sensor->trace_length)
+            return false;
+        uint32_t span_ms = sensor->trace[sensor->trace_length - 1].timestamp_ms + 1;
+        uint32_t trace_ms = timestamp_ms % span_ms;
+        if (trace_ms < sensor->previous_ms)
+            sensor->trace_index = 0;
+        sensor->previous_ms = trace_ms;
+        while (sensor->trace_index + 1 < sensor->trace_length &&
+               sensor->trace[sensor->trace_index + 1].timestamp_ms <= trace_ms)
+            sensor->trace_index++;
+        if (sensor->trace[sensor->trace_index].timestamp_ms > trace_ms)
+            return false;
+        *temp = sensor->trace[sensor->trace_index].temp;
+        return true;
+    }
+
+    const sim_scenario_t *scenario = sensor->scenario;
+    int32_t target = scenario->setpoint;
+    sensor->active_events = 0;
+
+    for (uint16_t i = 0; i < scenario->event_count; i++) {
+        const sim_event_t *event = &scenario->events[i];
+        if (!_event_active(event, timestamp_ms))
+            continue;
+        sensor->active_events |= 1 << event->type;
+        if (event->type != SIM_EVENT_DROPOUT)
+            target += event->magnitude;
+    }
+
+    /* First order approach to the target, scaled by the time since the last reading */
+    uint32_t elapsed_ms = timestamp_ms - sensor->previous_ms;
+    uint32_t fraction = elapsed_ms < 60000 ? scenario->response * elapsed_ms / 1000 : 256;
+    if (fraction > 256)
+        fraction = 256;
+    sensor->previous_ms = timestamp_ms;
+    sensor->temp += (int32_t) (((int64_t) target * (1 << SIM_EXTRA_FRAC_BITS) - sensor->temp) * fraction / 256);
+
+    int32_t reading = (sensor->temp >> SIM_EXTRA_FRAC_BITS) + _noise(sensor);
+    if (sensor->active_events & (1 << SIM_EVENT_DROPOUT))
+        return false;
+
+    *temp = temp_q4_to_q8(temp_q8_to_q4(reading < INT16_MIN ? INT16_MIN : reading > INT16_MAX ? INT16_MAX : reading));
+    return true;
 }
@@ -1,12 +1,88 @@
+/**
+ * @file        temp_simulation.h
+ * @brief       Deterministic simulation of temperature sensors. A virtual sensor
+ *              either runs a scripted scenario (thermal model, noise, door 
+ *              openings, defrost cycles, dropouts) from a seed, or replays a 
+ *              recorded trace. Builds both on the device and on a host.
+ * @version     0.2
+ * @date        2022-03-12
+ */
+
 #ifndef TEMP_SIMULATION_H
 #define TEMP_SIMULATION_H
 #include "stdint.h"
 #include "stdbool.h"
+#include "temp_fixed.h"
+
+typedef enum {
+    SIM_EVENT_DOOR_OPEN,        // Target temp. moves by magnitude while the door is open
+    SIM_EVENT_DEFROST,          // Target temp. moves by magnitude during a defrost cycle
+    SIM_EVENT_DROPOUT,          // No readings (e.g. 1-Wire bus error)
+    SIM_EVENT_SETPOINT          // Target temp. moves by magnitude (thermostat change)
+} SIM_EVENT_TYPE;
+
+typedef enum {
+    SIM_NOISE_NONE,
+    SIM_NOISE_UNIFORM,          // Uniform in +-amplitude
+    SIM_NOISE_GAUSSIAN,         // Approx. normal (Irwin-Hall), std. dev. ~amplitude/2
+    SIM_NOISE_SPIKES            // Gaussian plus a rare 8*amplitude spike
+} SIM_NOISE_PROFILE;
+
+/**
+ * @brief A scripted event. period_ms != 0 repeats the event every period_ms.
+ */
+typedef struct {
+    SIM_EVENT_TYPE type;
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    uint32_t period_ms;
+    temp_q8_t magnitude;
+} sim_event_t;
+
+/**
+ * @brief A scenario, shared by any number of virtual sensors.
+ */
+typedef struct {
+    temp_q8_t setpoint;             // Equilibrium temp. without events
+    uint16_t response;              // Fraction of the distance to the target covered per second, in 1/256
+    SIM_NOISE_PROFILE noise;
+    temp_q8_t noise_amplitude;
+    const sim_event_t *events;
+    uint16_t event_count;
+} sim_scenario_t;
+
+/**
+ * @brief One sample of a recorded trace.
+ */
+typedef struct {
+    uint32_t timestamp_ms;
+    temp_q8_t temp;
+} sim_trace_point_t;
+
+typedef enum {
+    SIM_MODE_SCENARIO,
+    SIM_MODE_TRACE
+} SIM_MODE;
+
+/**
+ * @brief State of one virtual sensor.
+ */
+typedef struct {
+    SIM_MODE mode;
+    const sim_scenario_t *scenario;
+    const sim_trace_point_t *trace;
+    uint32_t trace_length;
+    uint32_t trace_index;
+    uint32_t rng;                   // xorshift32 state, never 0
+    int32_t temp;                   // Modelled temp., Q7.8 with 8 more fraction bits
+    uint32_t previous_ms;
+    uint8_t active_events;          // Bit (1 << SIM_EVENT_TYPE) set while an event is active
+} sim_sensor_t;
+
+extern const sim_scenario_t simulate_scenario_refrigerator;
 
-uint16_t simulate_rand_temp(uint32_t min_temp, uint32_t max_temp);
-uint16_t simulate_temp_reading_normal();
-uint16_t simulate_temp_reading_cold();
-void simulate_temp_init();
-void simulate_temp_sensor_callback(bool door_open);
-void simulate_temp_sensor(bool door_start_open, uint32_t n);
+void simulate_sensor_init_scenario(sim_sensor_t *sensor, const sim_scenario_t *scenario, uint32_t seed);
+void simulate_sensor_init_trace(sim_sensor_t *sensor, const sim_trace_point_t *trace, uint32_t length);
+bool simulate_sensor_read(sim_sensor_t *sensor, uint32_t timestamp_ms, temp_q8_t *temp);
+uint32_t simulate_random(sim_sensor_t *sensor);
 #endif
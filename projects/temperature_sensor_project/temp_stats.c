@@ -0,0 +1,158 @@
+/**
+ * @file        temp_stats.c
+ * @brief       Streaming statistics (running mean/variance, EWMA, min/max and a
+ *              sliding window) in fixed-point arithmetic. Every update is O(1).
+ * @version     0.1
+ * @date        2022-03-08
+ */
+
+#include "temp_stats.h"
+
+/**
+ * @brief       Divides and rounds half away from zero.
+ */
+static int32_t _div_round(int64_t dividend, int64_t divisor)
+{
+    if ((dividend < 0) != (divisor < 0))
+        return (int32_t) ((dividend - divisor / 2) / divisor);
+    return (int32_t) ((dividend + divisor / 2) / divisor);
+}
+
+/**
+ * @brief       Initializes an EWMA.
+ *
+ * @param[out]  ewma: the EWMA to initialize.
+ * @param[in]   alpha: weight of a new sample in 1/256, see TEMP_STATS_ALPHA().
+ *
+ * @return      None.
+ */
+void temp_stats_ewma_init(temp_stats_ewma_t *ewma, uint16_t alpha)
+{
+    ewma->value = 0;
+    ewma->alpha = alpha;
+    ewma->primed = 0;
+}
+
+/**
+ * @brief       Forces the EWMA to a value, e.g. to seed a baseline.
+ *
+ * @param[out]  ewma: the EWMA to set.
+ * @param[in]   value: the new average with TEMP_STATS_FRAC_BITS fraction bits.
+ *
+ * @return      None.
+ */
+void temp_stats_ewma_set(temp_stats_ewma_t *ewma, int32_t value)
+{
+    ewma->value = value;
+    ewma->primed = 1;
+}
+
+/**
+ * @brief       Adds a sample to the EWMA. The first sample seeds the average.
+ *
+ * @param[out]  ewma: the EWMA to update.
+ * @param[in]   sample: the new sample (no fraction bits).
+ *
+ * @return      None.
+ */
+void temp_stats_ewma_update(temp_stats_ewma_t *ewma, int32_t sample)
+{
+    int32_t sample_fp = sample * (1 << TEMP_STATS_FRAC_BITS);
+
+    if (!ewma->primed) {
+        temp_stats_ewma_set(ewma, sample_fp);
+        return;
+    }
+
+    ewma->value += _div_round((int64_t) (sample_fp - ewma->value) * ewma->alpha, 256);
+}
+
+/**
+ * @brief       Initializes the running statistics.
+ *
+ * @param[out]  stats: the statistics to initialize.
+ * @param[in]   ewma_alpha: weight of a new sample in the EWMA, in 1/256.
+ *
+ * @return      None.
+ */
+void temp_stats_init(temp_stats_t *stats, uint16_t ewma_alpha)
+{
+    stats->count = 0;
+    stats->sum = 0;
+    stats->mean = 0;
+    stats->m2 = 0;
+    stats->min = INT32_MAX;
+    stats->max = INT32_MIN;
+    stats->window_sum = 0;
+    stats->window_head = 0;
+    stats->window_fill = 0;
+    temp_stats_ewma_init(&stats->ewma, ewma_alpha);
+}
+
+/**
+ * @brief       Adds a sample to the statistics in constant time.
+ *
+ * @param[out]  stats: the statistics to update.
+ * @param[in]   sample: the new sample (no fraction bits).
+ *
+ * @return      None.
+ */
+void temp_stats_update(temp_stats_t *stats, int32_t sample)
+{
+    int32_t sample_fp = sample * (1 << TEMP_STATS_FRAC_BITS);
+
+    /* Welford: m2 grows by delta * (x - new mean). The mean is taken from the
+       exact sum every time, since adding a rounded delta / n to it stops
+       moving once |delta| < n / 2 and drifts before that. */
+    int32_t delta = sample_fp - stats->mean;
+    stats->count++;
+    stats->sum += sample;
+    stats->mean = _div_round(stats->sum * (1 << TEMP_STATS_FRAC_BITS), stats->count);
+    stats->m2 += (int64_t) delta * (sample_fp - stats->mean);
+
+    if (sample < stats->min)
+        stats->min = sample;
+    if (sample > stats->max)
+        stats->max = sample;
+
+    temp_stats_ewma_update(&stats->ewma, sample);
+
+    /* Sliding window: replace the oldest sample and keep the sum up to date */
+    if (stats->window_fill == TEMP_STATS_WINDOW_SIZE)
+        stats->window_sum -= stats->window[stats->window_head];
+    else
+        stats->window_fill++;
+    stats->window[stats->window_head] = sample;
+    stats->window_sum += sample;
+    stats->window_head = (stats->window_head + 1) & TEMP_STATS_WINDOW_MASK;
+}
+
+/**
+ * @return      The mean of all samples with TEMP_STATS_FRAC_BITS fraction bits.
+ */
+int32_t temp_stats_mean(const temp_stats_t *stats)
+{
+    return stats->mean;
+}
+
+/**
+ * @return      The sample variance with TEMP_STATS_FRAC_BITS fraction bits,
+ *              or 0 if fewer than two samples have been seen.
+ */
+int32_t temp_stats_variance(const temp_stats_t *stats)
+{
+    if (stats->count < 2)
+        return 0;
+    return _div_round(stats->m2, (int64_t) (stats->count - 1) << TEMP_STATS_FRAC_BITS);
+}
+
+/**
+ * @return      The mean of the last TEMP_STATS_WINDOW_SIZE samples with
+ *              TEMP_STATS_FRAC_BITS fraction bits, or 0 if no samples have been seen.
+ */
+int32_t temp_stats_window_mean(const temp_stats_t *stats)
+{
+    if (!stats->window_fill)
+        return 0;
+    return _div_round((int64_t) stats->window_sum * (1 << TEMP_STATS_FRAC_BITS), stats->window_fill);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file        temp_stats.h
+ * @brief       Streaming statistics (running mean/variance, EWMA, min/max and a
+ *              sliding window) in fixed-point arithmetic. Every update is O(1).
+ * @version     0.1
+ * @date        2022-03-08
+ */
+
+#ifndef TEMP_STATS_H
+#define TEMP_STATS_H
+
+#include "stdint.h"
+
+/**
+ * @brief Number of fraction bits used for means, variances and EWMAs.
+ */
+#define TEMP_STATS_FRAC_BITS    8
+
+/**
+ * @brief Number of samples in the sliding window (must be a power of two).
+ */
+#define TEMP_STATS_WINDOW_SIZE  8
+#define TEMP_STATS_WINDOW_MASK  (TEMP_STATS_WINDOW_SIZE - 1)
+
+/**
+ * @brief EWMA weight for a new sample, counted in 1/256 (256 = no smoothing).
+ */
+#define TEMP_STATS_ALPHA(num, den) ((uint16_t) (((num) * 256) / (den)))
+
+/**
+ * @brief Exponentially weighted moving average.
+ */
+typedef struct {
+    int32_t value;          // Current average, TEMP_STATS_FRAC_BITS fraction bits
+    uint16_t alpha;         // Weight of a new sample in 1/256
+    uint8_t primed;         // Set once the first sample has been seen
+} temp_stats_ewma_t;
+
+/**
+ * @brief Running statistics for one stream of samples.
+ */
+typedef struct {
+    uint32_t count;         // Number of samples seen
+    int64_t sum;            // Exact sum of the samples, no fraction bits
+    int32_t mean;           // sum / count, TEMP_STATS_FRAC_BITS fraction bits
+    int64_t m2;             // Sum of squared differences, 2 * TEMP_STATS_FRAC_BITS fraction bits
+    int32_t min;
+    int32_t max;
+    temp_stats_ewma_t ewma;
+    int32_t window[TEMP_STATS_WINDOW_SIZE];
+    int32_t window_sum;
+    uint8_t window_head;
+    uint8_t window_fill;
+} temp_stats_t;
+
+void temp_stats_init(temp_stats_t *stats, uint16_t ewma_alpha);
+void temp_stats_update(temp_stats_t *stats, int32_t sample);
+int32_t temp_stats_mean(const temp_stats_t *stats);
+int32_t temp_stats_variance(const temp_stats_t *stats);
+int32_t temp_stats_window_mean(const temp_stats_t *stats);
+
+void temp_stats_ewma_init(temp_stats_ewma_t *ewma, uint16_t alpha);
+void temp_stats_ewma_set(temp_stats_ewma_t *ewma, int32_t value);
+void temp_stats_ewma_update(temp_stats_ewma_t *ewma, int32_t sample);
+
+#endif /* TEMP_STATS_H */
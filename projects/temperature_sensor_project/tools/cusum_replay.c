@@ -0,0 +1,178 @@
+/**
+ * @file        cusum_replay.c
+ * @brief       Host (Linux) replay harness for the change-point detector. Feeds a
+ *              recorded trace through change_detect.c and reports detection latency
+ *              and false alarms against the labelled events in the trace.
+ *
+ *              Build from this directory:
+ *                  gcc -O2 -I.. -o cusum_replay cusum_replay.c ../change_detect.c \
+ *                      ../temp_stats.c ../temp_fixed.c -lm
+ *
+ *              Trace format (CSV, one sample per line, '#' starts a comment):
+ *                  timestamp_ms,temperature_celsius,event
+ *              where event is 1 while a real change (door open, heating) is going on
+ *              and 0 otherwise. Sample traces are in tools/traces/:
+ *                  ./cusum_replay -v traces/fridge_door.csv
+ * @version     0.1
+ * @date        2022-03-10
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "change_detect.h"
+
+/**
+ * @brief Detection statistics for one replayed trace.
+ */
+typedef struct {
+    uint32_t samples;
+    uint32_t events;            // Labelled event onsets
+    uint32_t detected;          // Onsets followed by a CHECK before the event ended
+    uint64_t latency_sum_ms;
+    uint32_t latency_max_ms;
+    uint32_t false_alarms;      // CHECK transitions outside every labelled event (+ grace)
+    uint64_t quiet_ms;          // Time spent outside events, for the false alarm rate
+} replay_report_t;
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-k drift] [-h threshold] [-r rate_limit] [-s rate_span_ms]\n"
+            "          [-w warmup] [-g grace_ms] [-v] trace.csv...\n"
+            "  temperatures (drift, threshold, rate_limit) are given in degrees Celsius\n",
+            name);
+}
+
+static temp_q8_t to_q8(double celsius)
+{
+    return (temp_q8_t) lround(celsius * (1 << TEMP_Q8_FRAC_BITS));
+}
+
+/**
+ * @brief       Replays one trace.
+ *
+ * @param[in]   path: the trace file.
+ * @param[in]   config: the detector tuning.
+ * @param[in]   grace_ms: time after an event ends where a CHECK is still not a false alarm.
+ * @param[in]   verbose: print every transition.
+ * @param[out]  report: accumulated results.
+ *
+ * @return      0 on success, -1 if the file could not be read.
+ */
+static int replay(const char *path, const change_detect_config_t *config, uint32_t grace_ms, int verbose,
+                  replay_report_t *report)
+{
+    FILE *trace = fopen(path, "r");
+    if (!trace) {
+        perror(path);
+        return -1;
+    }
+
+    change_detect_t detector;
+    change_detect_init(&detector, config);
+
+    char line[256];
+    int in_event = 0, event_detected = 0;
+    uint32_t event_start_ms = 0, event_end_ms = 0, previous_ms = 0;
+    int have_previous = 0, have_event_end = 0;
+
+    while (fgets(line, sizeof line, trace)) {
+        char *hash = strchr(line, '#');
+        if (hash)
+            *hash = '\0';
+
+        unsigned long timestamp_ms;
+        double celsius;
+        int label = 0;
+        if (sscanf(line, "%lu,%lf,%d", &timestamp_ms, &celsius, &label) < 2)
+            continue;
+
+        report->samples++;
+        if (have_previous && !in_event)
+            report->quiet_ms += (uint32_t) timestamp_ms - previous_ms;
+        previous_ms = (uint32_t) timestamp_ms;
+        have_previous = 1;
+
+        if (label && !in_event) {
+            in_event = 1;
+            event_detected = 0;
+            event_start_ms = (uint32_t) timestamp_ms;
+            report->events++;
+        } else if (!label && in_event) {
+            in_event = 0;
+            event_end_ms = (uint32_t) timestamp_ms;
+            have_event_end = 1;
+        }
+
+        change_detect_event_t event;
+        if (!change_detect_update(&detector, to_q8(celsius), (uint32_t) timestamp_ms, &event))
+            continue;
+
+        if (verbose)
+            printf("%s: %10lu ms %s (cause %d)\n", path, timestamp_ms,
+                   event.status == CHANGE_DETECT_CHECK ? "CHECK" : "OK", event.cause);
+
+        if (event.status != CHANGE_DETECT_CHECK)
+            continue;
+
+        if (in_event) {
+            if (!event_detected) {
+                uint32_t latency_ms = event.timestamp_ms - event_start_ms;
+                event_detected = 1;
+                report->detected++;
+                report->latency_sum_ms += latency_ms;
+                if (latency_ms > report->latency_max_ms)
+                    report->latency_max_ms = latency_ms;
+            }
+        } else if (!have_event_end || event.timestamp_ms - event_end_ms > grace_ms) {
+            report->false_alarms++;
+        }
+    }
+
+    fclose(trace);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    change_detect_config_t config = CHANGE_DETECT_DEFAULT_CONFIG;
+    uint32_t grace_ms = 30000;
+    int verbose = 0, option;
+
+    while ((option = getopt(argc, argv, "k:h:r:s:w:g:v")) != -1) {
+        switch (option) {
+            case 'k': config.drift = to_q8(atof(optarg)); break;
+            case 'h': config.threshold = to_q8(atof(optarg)); break;
+            case 'r': config.rate_limit = to_q8(atof(optarg)); break;
+            case 's': config.rate_span_ms = strtoul(optarg, NULL, 10); break;
+            case 'w': config.warmup = (uint8_t) atoi(optarg); break;
+            case 'g': grace_ms = strtoul(optarg, NULL, 10); break;
+            case 'v': verbose = 1; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    replay_report_t report = {0};
+    for (int i = optind; i < argc; i++)
+        if (replay(argv[i], &config, grace_ms, verbose, &report))
+            return 1;
+
+    printf("samples:          %u\n", report.samples);
+    printf("events:           %u\n", report.events);
+    printf("detected:         %u (%.1f %%)\n", report.detected,
+           report.events ? 100.0 * report.detected / report.events : 0.0);
+    if (report.detected)
+        printf("latency:          mean %.0f ms, max %u ms\n",
+               (double) report.latency_sum_ms / report.detected, report.latency_max_ms);
+    printf("false alarms:     %u (%.2f per hour without events)\n", report.false_alarms,
+           report.quiet_ms ? report.false_alarms * 3600000.0 / report.quiet_ms : 0.0);
+    return 0;
+}
@@ -0,0 +1,178 @@
+"""Converter from images to the run-length coded palette format of lcd_image.h.
+
+Reads binary or ASCII PPM files (P6/P3) directly, and any format Pillow can
+open (PNG, BMP, ...) if Pillow is installed. Colours are reduced to RGB565
+first; an image may use at most 128 of them. Usage::
+
+    $ python img2lcd.py icon_wifi.png -n icon_wifi -o ../icon_wifi.c
+
+The generated source defines ``const lcd_image_t icon_wifi``; draw it with
+``lcd_image_draw(x, y, &icon_wifi)`` after declaring it ``extern``.
+"""
+import argparse
+import sys
+
+MAX_COLORS = 128
+MAX_RUN = 129
+
+
+def _read_ppm(data: bytes) -> tuple:
+    """Parse a P6 or P3 PPM file.
+
+    :return: (width, height, list of (r, g, b) tuples in row order).
+    """
+    fields = []
+    position = 0
+    while len(fields) < 4:
+        while position < len(data) and data[position:position + 1].isspace():
+            position += 1
+        if data[position:position + 1] == b"#":
+            while position < len(data) and data[position] != 0x0A:
+                position += 1
+            continue
+        start = position
+        while position < len(data) and not data[position:position + 1].isspace():
+            position += 1
+        fields.append(data[start:position])
+    magic, width, height, maximum = fields[0], int(fields[1]), int(fields[2]), int(fields[3])
+
+    if magic == b"P6":
+        if maximum > 255:
+            raise ValueError("16-bit PPM files are not supported.")
+        samples = data[position + 1:position + 1 + width * height * 3]
+    elif magic == b"P3":
+        samples = [int(value) for value in data[position:].split()]
+    else:
+        raise ValueError("Not a PPM file.")
+    if len(samples) < width * height * 3:
+        raise ValueError("PPM file is truncated.")
+
+    scale = 255 / maximum
+    pixels = [tuple(round(samples[i + c] * scale) for c in range(3))
+              for i in range(0, width * height * 3, 3)]
+    return width, height, pixels
+
+
+def load_image(path: str) -> tuple:
+    """Load an image file as (width, height, list of (r, g, b) tuples)."""
+    with open(path, "rb") as image_file:
+        data = image_file.read()
+    if data[:2] in (b"P6", b"P3"):
+        return _read_ppm(data)
+
+    try:
+        from PIL import Image
+    except ImportError:
+        raise ValueError("Only PPM files can be read without Pillow.")
+    image = Image.open(path).convert("RGB")
+    return image.width, image.height, list(image.getdata())
+
+
+def rgb565(r: int, g: int, b: int) -> int:
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+
+def encode(pixels: list) -> tuple:
+    """Run-length code RGB565 pixels.
+
+    :return: (palette as a list of RGB565 values, coded bytes).
+    """
+    palette = []
+    indexes = {}
+    for color in pixels:
+        if color not in indexes:
+            if len(palette) == MAX_COLORS:
+                raise ValueError("The image has more than %d colours." % MAX_COLORS)
+            indexes[color] = len(palette)
+            palette.append(color)
+
+    data = bytearray()
+    position = 0
+    while position < len(pixels):
+        index = indexes[pixels[position]]
+        run = 1
+        while (position + run < len(pixels) and run < MAX_RUN
+               and pixels[position + run] == pixels[position]):
+            run += 1
+        if run == 1:
+            data.append(index)
+        else:
+            data += bytes((0x80 | (run - 2), index))
+        position += run
+    return palette, bytes(data)
+
+
+def decode(palette: list, data: bytes) -> list:
+    """Inverse of encode(), as done on the device by lcd_image_draw()."""
+    pixels = []
+    position = 0
+    while position < len(data):
+        code = data[position]
+        position += 1
+        run = 1
+        if code & 0x80:
+            run = (code & 0x7F) + 2
+            code = data[position]
+            position += 1
+        pixels += [palette[code]] * run
+    return pixels
+
+
+def to_c(name: str, width: int, height: int, palette: list, data: bytes) -> str:
+    lines = ['/* Generated by tools/img2lcd.py, do not edit */',
+             '',
+             '#include "lcd_image.h"',
+             '',
+             'static const uint16_t %s_palette[%d] = {' % (name, len(palette))]
+    for i in range(0, len(palette), 8):
+        lines.append('    ' + ' '.join('0x%04X,' % color for color in palette[i:i + 8]))
+    lines += ['};', '', 'static const uint8_t %s_data[%d] = {' % (name, len(data))]
+    for i in range(0, len(data), 12):
+        lines.append('    ' + ' '.join('0x%02X,' % byte for byte in data[i:i + 12]))
+    lines += ['};',
+              '',
+              'const lcd_image_t %s = {' % name,
+              '    .width = %d,' % width,
+              '    .height = %d,' % height,
+              '    .colors = %d,' % len(palette),
+              '    .palette = %s_palette,' % name,
+              '    .data = %s_data,' % name,
+              '    .size = sizeof(%s_data),' % name,
+              '};',
+              '']
+    return '\n'.join(lines)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Convert an image to an lcd_image_t C source.")
+    parser.add_argument("image")
+    parser.add_argument("-n", "--name", required=True, help="C identifier of the image")
+    parser.add_argument("-o", "--output", help="output file, standard output if not given")
+    arguments = parser.parse_args()
+
+    try:
+        width, height, rgb = load_image(arguments.image)
+    except (OSError, ValueError) as error:
+        print("img2lcd: %s" % error, file=sys.stderr)
+        exit(1)
+    if width > 255 or height > 255:
+        print("img2lcd: images are limited to 255x255 pixels", file=sys.stderr)
+        exit(1)
+
+    pixels = [rgb565(*color) for color in rgb]
+    try:
+        palette, data = encode(pixels)
+    except ValueError as error:
+        print("img2lcd: %s" % error, file=sys.stderr)
+        exit(1)
+    assert decode(palette, data) == pixels
+
+    source = to_c(arguments.name, width, height, palette, data)
+    if arguments.output:
+        with open(arguments.output, "w") as output_file:
+            output_file.write(source)
+    else:
+        sys.stdout.write(source)
+    print("img2lcd: %dx%d, %d colours, %d bytes (raw %d)"
+          % (width, height, len(palette), len(data) + 2 * len(palette), 2 * width * height),
+          file=sys.stderr)
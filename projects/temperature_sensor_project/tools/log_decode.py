@@ -0,0 +1,157 @@
+"""Decoder of deferred log packets (see logger.h).
+
+The firmware stores only the offset of each format string in the ELF section
+.logstr, so the ELF file the firmware was built from is needed to print the
+messages. Packets are read from files holding one or more packets back to
+back, e.g. saved with ``mosquitto_sub -N -t home/sensors/log/refrigerator/1 > log.bin``.
+Usage::
+
+    $ python log_decode.py build/temperature_sensor_project.elf log.bin
+    [    12.304518] DEBUG AT > AT+MQTTPUBRAW=0,"home/sensors/log/refrigerator/1",1044,0,0\\r\\n
+
+Time stamps are mcycle counts at the core clock of the moment. The clock is
+known at the end of every packet and at every switch (clock records), and each
+stretch is converted at its own clock, as trace_export.py does. Give all files
+of one run in one call, so the stretches join up. Times count from reset, at
+the clock before the first known point until it.
+"""
+import re
+import struct
+import sys
+
+from trace_export import to_seconds
+
+LOG_VERSION = 2
+LOG_MARKER = 0xA5
+HEADER = struct.Struct("<2sBBIIQ")
+LEVELS = {0: "DEBUG", 1: "INFO ", 2: "WARN ", 3: "ERROR", 15: "CLOCK"}
+LEVEL_CLOCK = 15
+
+# printf conversions the firmware supports; 'l' and 'h' length modifiers are ignored
+CONVERSION = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l)?([diuxXocs%])")
+
+
+def read_format_section(path: str) -> bytes:
+    """Read the .logstr section of an ELF file.
+
+    :return: Contents of the section.
+    :rtype: bytes
+    """
+    with open(path, "rb") as elf_file:
+        elf = elf_file.read()
+    if elf[:4] != b"\x7fELF":
+        raise ValueError("%s is not an ELF file." % path)
+    is_64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+
+    if is_64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        section = struct.Struct(endian + "IIQQQQIIQQ")
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        section = struct.Struct(endian + "IIIIIIIIII")
+
+    headers = [section.unpack_from(elf, shoff + i * shentsize) for i in range(shnum)]
+    names = headers[shstrndx]
+    for header in headers:
+        name_offset = names[4] + header[0]
+        name = elf[name_offset:elf.index(b"\0", name_offset)]
+        if name == b".logstr":
+            return elf[header[4]:header[4] + header[5]]
+    raise ValueError("%s has no .logstr section, was it built with logger.h?" % path)
+
+
+def format_message(fmt: str, arguments: list) -> str:
+    """Format a message like printf, with 32-bit int arguments.
+
+    A %s argument is a length word followed by the characters packed in words.
+    """
+    arguments = list(arguments)
+
+    def convert(match):
+        flags, width, precision, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        if not arguments:
+            return "<missing>"
+        value = arguments.pop(0)
+        if conversion == "s":
+            words = (value + 3) // 4
+            packed = struct.pack("<%dI" % words, *arguments[:words])
+            del arguments[:words]
+            text = packed[:value].decode("latin-1")
+            return ("%" + flags + width + "s") % text.encode("unicode_escape").decode("ascii")
+        if conversion in "di" and value & 0x80000000:
+            value -= 1 << 32
+        if conversion == "c":
+            value = chr(value & 0xFF)
+        if conversion in "iu":
+            conversion = "d"
+        spec = "%" + flags + width + ("." + precision if precision else "") + conversion
+        return spec % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+def decode_packets(data: bytes, formats: bytes) -> tuple:
+    """Decode back to back packets.
+
+    :return: List of (mcycle, level, message) tuples, list of clock points as
+             (mcycle, Hz before, Hz after) and the number of dropped messages,
+             as (messages, clocks, dropped).
+    :rtype: tuple
+    """
+    messages = []
+    clocks = []
+    dropped = 0
+    position = 0
+    while position + HEADER.size <= len(data):
+        magic, version, _, core_hz, packet_dropped, now = HEADER.unpack_from(data, position)
+        if magic != b"LG" or version != LOG_VERSION:
+            raise ValueError("No log packet at offset %d." % position)
+        position += HEADER.size
+        dropped += packet_dropped
+        clocks.append((now, core_hz, core_hz))
+
+        while position + 8 <= len(data) and data[position] == LOG_MARKER:
+            header, time = struct.unpack_from("<II", data, position)
+            level = (header >> 8) & 0xF
+            words = (header >> 12) & 0xF
+            offset = header >> 16
+            arguments = struct.unpack_from("<%dI" % words, data, position + 8)
+            position += 8 + 4 * words
+
+            # Time stamps are the low 32 bits of mcycle, all taken before 'now'
+            cycles = now - ((now - time) & 0xFFFFFFFF)
+            if level == LEVEL_CLOCK and arguments:
+                old_mhz, new_mhz = arguments[0] >> 8, arguments[0] & 0xFF
+                clocks.append((cycles, old_mhz * 1000000, new_mhz * 1000000))
+                messages.append((cycles, level, "%d MHz -> %d MHz" % (old_mhz, new_mhz)))
+                continue
+            end = formats.find(b"\0", offset)
+            fmt = formats[offset:end].decode("latin-1") if offset < len(formats) else "<bad id %d>" % offset
+            messages.append((cycles, level, format_message(fmt, arguments)))
+    return messages, clocks, dropped
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        print("usage: python log_decode.py firmware.elf log.bin...")
+        exit(2)
+
+    format_section = read_format_section(sys.argv[1])
+    all_messages = []
+    all_clocks = []
+    all_dropped = 0
+    for path in sys.argv[2:]:
+        with open(path, "rb") as log_file:
+            file_messages, file_clocks, file_dropped = decode_packets(log_file.read(), format_section)
+        all_messages += file_messages
+        all_clocks += file_clocks
+        all_dropped += file_dropped
+    for seconds, message_level, text in to_seconds(all_messages, all_clocks):
+        print("[%12.6f] %s %s" % (seconds, LEVELS.get(message_level, "?    "), text))
+    if all_dropped:
+        print("log_decode: %d messages dropped" % all_dropped, file=sys.stderr)
@@ -0,0 +1,116 @@
+/**
+ * @file        mem_check.c
+ * @brief       Host (Linux) check of mem.c against the C library. The firmware
+ *              functions are built as mem_memcpy() etc. and run for every size
+ *              up to a limit and every source and destination alignment, with
+ *              guard bytes around the destination. memmove is run on
+ *              overlapping buffers both ways, memcmp with a difference at every
+ *              position. The code is the same little endian word code as on
+ *              the device, so x86 and RISC-V hosts both do.
+ *
+ *              Build from this directory:
+ *                  gcc -O2 -DMEM_HOST_TEST -I.. -o mem_check mem_check.c ../mem.c
+ *
+ *              Usage: mem_check [-n max_size]
+ * @version     0.1
+ * @date        2022-03-25
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mem.h"
+
+#define GUARD   16
+
+static size_t max_size = 300;
+static unsigned long errors = 0, checks = 0;
+
+static void _fill(unsigned char *d, size_t n, unsigned seed)
+{
+    while (n--) {
+        seed = seed * 1103515245u + 12345;
+        *d++ = (unsigned char) (seed >> 16) | 1;     // No zero bytes, for strlen
+    }
+}
+
+static void _expect(int ok, const char *function, size_t n, size_t from, size_t to)
+{
+    checks++;
+    if (!ok && errors++ < 10)
+        fprintf(stderr, "%s failed, size %zu, source offset %zu, destination offset %zu\n",
+                function, n, from, to);
+}
+
+static int _sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+static void _check(size_t n, size_t from, size_t to, unsigned char *source,
+                   unsigned char *got, unsigned char *want, size_t size)
+{
+    size_t i;
+
+    _fill(source, size, (unsigned) (n * 16 + from * 4 + to));
+
+    _fill(got, size, 1);
+    _fill(want, size, 1);
+    mem_memcpy(got + GUARD + to, source + from, n);
+    memcpy(want + GUARD + to, source + from, n);
+    _expect(!memcmp(got, want, size), "memcpy", n, from, to);
+
+    /* Overlapping, destination above and below the source */
+    mem_memmove(got + GUARD + to, got + GUARD + from, n);
+    memmove(want + GUARD + to, want + GUARD + from, n);
+    _expect(!memcmp(got, want, size), "memmove", n, from, to);
+
+    mem_memset(got + GUARD + to, (int) (0xF0 + from), n);
+    memset(want + GUARD + to, (int) (0xF0 + from), n);
+    _expect(!memcmp(got, want, size), "memset", n, from, to);
+
+    memcpy(got + to, source + from, n);
+    _expect(!mem_memcmp(got + to, source + from, n), "memcmp", n, from, to);
+    for (i = 0; i < n; i++) {
+        got[to + i] ^= 0x80;
+        _expect(_sign(mem_memcmp(got + to, source + from, n)) == _sign(memcmp(got + to, source + from, n)),
+                "memcmp", n, from, to);
+        got[to + i] ^= 0x80;
+    }
+
+    source[from + n] = 0;
+    _expect(mem_strlen((const char *) source + from) == n, "strlen", n, from, to);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned char *source, *got, *want;
+    size_t size, n, from, to;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:")) != -1) {
+        if (option == 'n') {
+            max_size = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n max_size]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    /* Word aligned buffers, so the offsets are the alignments */
+    size = (max_size + 2 * GUARD + 8 + 3) & ~(size_t) 3;
+    source = aligned_alloc(4, size);
+    got = aligned_alloc(4, size);
+    want = aligned_alloc(4, size);
+    if (!source || !got || !want)
+        return 2;
+
+    for (n = 0; n <= max_size; n++)
+        for (from = 0; from < 4; from++)
+            for (to = 0; to < 4; to++)
+                _check(n, from, to, source, got, want, size);
+
+    printf("%lu checks, %lu errors\n", checks, errors);
+    return errors != 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file        ring_stress.c
+ * @brief       Host (Linux) stress test of ring.h. A producer thread pushes a
+ *              counting sequence and a consumer thread checks it comes out in
+ *              order, both picking single, bulk and span calls at random, so
+ *              every wrap position and partial span is hit. Also run it with
+ *              -fsanitize=thread to catch missing ordering.
+ *
+ *              Build from this directory:
+ *                  gcc -O2 -pthread -I.. -o ring_stress ring_stress.c
+ *
+ *              Usage: ring_stress [-n values]
+ * @version     0.1
+ * @date        2022-03-20
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include "ring.h"
+
+RING_DEFINE(test_ring, uint32_t, 64)
+
+static test_ring_t ring;
+static uint32_t total = 50000000;
+static uint32_t errors = 0;
+
+static uint32_t _random(uint32_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void *producer(void *argument)
+{
+    uint32_t state = 0x12345678, next = 0, values[40], span, i;
+    (void) argument;
+
+    while (next < total) {
+        uint32_t before = next;
+        uint32_t want = 1 + _random(&state) % 40;
+        if (want > total - next)
+            want = total - next;
+
+        switch (_random(&state) % 3) {
+        case 0:
+            next += test_ring_push(&ring, next);
+            break;
+        case 1:
+            for (i = 0; i < want; i++)
+                values[i] = next + i;
+            next += test_ring_push_n(&ring, values, want);
+            break;
+        default: {
+            uint32_t *slot = test_ring_write_span(&ring, &span);
+            if (span > want)
+                span = want;
+            for (i = 0; i < span; i++)
+                slot[i] = next + i;
+            test_ring_write_commit(&ring, span);
+            next += span;
+        }
+        }
+        if (next == before)
+            sched_yield();              // Full, let the consumer run on a single core
+    }
+    return NULL;
+}
+
+static void *consumer(void *argument)
+{
+    uint32_t state = 0x87654321, expected = 0, values[40], got, i;
+    (void) argument;
+
+    while (expected < total) {
+        uint32_t want = 1 + _random(&state) % 40;
+
+        switch (_random(&state) % 3) {
+        case 0:
+            got = test_ring_pop(&ring, values);
+            break;
+        case 1:
+            got = test_ring_pop_n(&ring, values, want);
+            break;
+        default: {
+            const uint32_t *slot = test_ring_read_span(&ring, &got);
+            if (got > want)
+                got = want;
+            for (i = 0; i < got; i++)
+                values[i] = slot[i];
+            test_ring_read_release(&ring, got);
+        }
+        }
+
+        if (!got)
+            sched_yield();
+        for (i = 0; i < got; i++, expected++) {
+            if (values[i] != expected && errors++ < 10)
+                fprintf(stderr, "value %u, expected %u\n", values[i], expected);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t threads[2];
+    struct timespec start, end;
+    double seconds;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:")) != -1) {
+        if (option == 'n') {
+            total = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n values]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    test_ring_init(&ring);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pthread_create(&threads[0], NULL, producer, NULL);
+    pthread_create(&threads[1], NULL, consumer, NULL);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%u values in %.2f s (%.1f M/s), %u errors, %u left in the ring\n",
+           total, seconds, total / seconds / 1e6, errors, test_ring_count(&ring));
+    return errors != 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file        sim_bench.c
+ * @brief       Host (Linux) load test. Instantiates thousands of virtual sensors
+ *              from temp_simulation.c and runs every reading through the same 
+ *              statistics, change-point detection and batch encoding as the 
+ *              firmware, then reports throughput.
+ *
+ *              Build from this directory:
+ *                  gcc -O2 -I.. -o sim_bench sim_bench.c ../temp_simulation.c \
+ *                      ../temp_stats.c ../change_detect.c ../ts_codec.c ../temp_fixed.c -lm
+ *
+ *              -o writes sensor 0 as a labelled trace for cusum_replay, and -t 
+ *              replays a trace (timestamp_ms,temperature_celsius[,...]) on every sensor.
+ * @version     0.1
+ * @date        2022-03-12
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "temp_simulation.h"
+#include "temp_stats.h"
+#include "change_detect.h"
+#include "ts_codec.h"
+
+#define BATCH_READINGS 64
+#define BATCH_BYTES 128
+
+/**
+ * @brief Everything the firmware keeps per sensor.
+ */
+typedef struct {
+    sim_sensor_t sim;
+    temp_stats_t stats;
+    change_detect_t detector;
+    ts_encoder_t batch;
+    uint8_t batch_buffer[BATCH_BYTES];
+} virtual_sensor_t;
+
+static const sim_event_t freezer_events[] = {
+    { .type = SIM_EVENT_DOOR_OPEN, .start_ms = 200000, .duration_ms = 20000, .period_ms = 900000,
+      .magnitude = TEMP_Q8_FROM_INT(15) },
+    { .type = SIM_EVENT_DEFROST, .start_ms = 1800000, .duration_ms = 900000, .period_ms = 28800000,
+      .magnitude = TEMP_Q8_FROM_INT(6) },
+    { .type = SIM_EVENT_DROPOUT, .start_ms = 500000, .duration_ms = 5000, .period_ms = 1000000,
+      .magnitude = 0 },
+};
+
+static const sim_scenario_t freezer = {
+    .setpoint = TEMP_Q8_FROM_INT(-18),
+    .response = 12,
+    .noise = SIM_NOISE_SPIKES,
+    .noise_amplitude = TEMP_Q8_FROM_TENTHS(2),
+    .events = freezer_events,
+    .event_count = sizeof freezer_events / sizeof freezer_events[0],
+};
+
+static const sim_scenario_t quiet_room = {
+    .setpoint = TEMP_Q8_FROM_INT(21),
+    .response = 4,
+    .noise = SIM_NOISE_UNIFORM,
+    .noise_amplitude = TEMP_Q8_FROM_TENTHS(1),
+    .events = 0,
+    .event_count = 0,
+};
+
+static const sim_scenario_t *scenarios[] = {&simulate_scenario_refrigerator, &freezer, &quiet_room};
+#define SCENARIOS (sizeof scenarios / sizeof scenarios[0])
+
+static sim_trace_point_t *load_trace(const char *path, uint32_t *length)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        exit(1);
+    }
+
+    uint32_t capacity = 1024;
+    sim_trace_point_t *trace = malloc(capacity * sizeof *trace);
+    char line[256];
+    *length = 0;
+
+    while (fgets(line, sizeof line, file)) {
+        unsigned long timestamp_ms;
+        double celsius;
+        if (line[0] == '#' || sscanf(line, "%lu,%lf", &timestamp_ms, &celsius) != 2)
+            continue;
+        if (*length == capacity)
+            trace = realloc(trace, (capacity *= 2) * sizeof *trace);
+        trace[*length].timestamp_ms = (uint32_t) timestamp_ms;
+        trace[(*length)++].temp = (temp_q8_t) lround(celsius * (1 << TEMP_Q8_FRAC_BITS));
+    }
+
+    fclose(file);
+    return trace;
+}
+
+static double now_s(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sensor_count = 4096, duration_s = 3600, period_ms = 800, seed = 1;
+    const char *trace_path = NULL, *output_path = NULL;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:d:p:s:t:o:")) != -1) {
+        switch (option) {
+            case 'n': sensor_count = strtoul(optarg, NULL, 10); break;
+            case 'd': duration_s = strtoul(optarg, NULL, 10); break;
+            case 'p': period_ms = strtoul(optarg, NULL, 10); break;
+            case 's': seed = strtoul(optarg, NULL, 10); break;
+            case 't': trace_path = optarg; break;
+            case 'o': output_path = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n sensors] [-d seconds] [-p period_ms] [-s seed] "
+                        "[-t trace.csv] [-o sensor0.csv]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    static const change_detect_config_t config = CHANGE_DETECT_DEFAULT_CONFIG;
+    virtual_sensor_t *sensors = calloc(sensor_count, sizeof *sensors);
+    sim_trace_point_t *trace = NULL;
+    uint32_t trace_length = 0;
+    if (trace_path)
+        trace = load_trace(trace_path, &trace_length);
+
+    for (uint32_t i = 0; i < sensor_count; i++) {
+        if (trace)
+            simulate_sensor_init_trace(&sensors[i].sim, trace, trace_length);
+        else
+            simulate_sensor_init_scenario(&sensors[i].sim, scenarios[i % SCENARIOS], seed + i);
+        temp_stats_init(&sensors[i].stats, TEMP_STATS_ALPHA(1, 4));
+        change_detect_init(&sensors[i].detector, &config);
+        ts_encoder_init(&sensors[i].batch, sensors[i].batch_buffer, BATCH_BYTES);
+    }
+
+    FILE *output = output_path ? fopen(output_path, "w") : NULL;
+    if (output)
+        fprintf(output, "# timestamp_ms,temperature_celsius,event\n");
+
+    uint64_t readings = 0, dropouts = 0, transitions = 0, batches = 0, payload_bytes = 0;
+    uint64_t batched_readings = 0;
+    double start_s = now_s();
+
+    for (uint32_t timestamp_ms = period_ms; timestamp_ms <= duration_s * 1000; timestamp_ms += period_ms) {
+        for (uint32_t i = 0; i < sensor_count; i++) {
+            virtual_sensor_t *sensor = &sensors[i];
+            temp_q8_t temp;
+
+            if (!simulate_sensor_read(&sensor->sim, timestamp_ms, &temp)) {
+                dropouts++;
+                continue;
+            }
+            readings++;
+
+            if (output && i == 0)
+                fprintf(output, "%u,%.4f,%d\n", timestamp_ms, temp / 256.0,
+                        (sensor->sim.active_events & (1 << SIM_EVENT_DOOR_OPEN)) != 0);
+
+            temp_stats_update(&sensor->stats, temp);
+            if (change_detect_update(&sensor->detector, temp, timestamp_ms, NULL))
+                transitions++;
+
+            temp_q4_t temp_q4 = temp_q8_to_q4(temp);
+            if (sensor->batch.count < BATCH_READINGS && ts_encoder_add(&sensor->batch, timestamp_ms, temp_q4))
+                continue;
+            /* A batch also closes early when the buffer is full, so count what it holds */
+            batched_readings += sensor->batch.count;
+            payload_bytes += ts_encoder_finish(&sensor->batch);
+            batches++;
+            ts_encoder_init(&sensor->batch, sensor->batch_buffer, BATCH_BYTES);
+            ts_encoder_add(&sensor->batch, timestamp_ms, temp_q4);
+        }
+    }
+
+    double elapsed_s = now_s() - start_s;
+
+    printf("sensors:          %u (%s)\n", sensor_count, trace ? "trace" : "scenarios");
+    printf("simulated time:   %u s at %u ms per reading\n", duration_s, period_ms);
+    printf("readings:         %llu (%llu dropouts)\n", (unsigned long long) readings,
+           (unsigned long long) dropouts);
+    printf("wall time:        %.3f s\n", elapsed_s);
+    printf("throughput:       %.0f readings/s (%.0f ns per reading)\n", readings / elapsed_s,
+           readings ? elapsed_s * 1e9 / readings : 0.0);
+    printf("transitions:      %llu\n", (unsigned long long) transitions);
+    printf("batches:          %llu, %.2f bytes per reading\n", (unsigned long long) batches,
+           batched_readings ? (double) payload_bytes / batched_readings : 0.0);
+
+    if (output)
+        fclose(output);
+    free(trace);
+    free(sensors);
+    return 0;
+}
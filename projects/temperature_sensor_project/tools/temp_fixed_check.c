@@ -0,0 +1,207 @@
+/**
+ * @file        temp_fixed_check.c
+ * @brief       Host (Linux) check of the fixed-point temperature pipeline. Goes
+ *              through every stage a reading passes on the device: sign
+ *              extension of the DS18B20 word, Q11.4 to Q7.8, the window mean
+ *              of temp_stats.c narrowed back to Q7.8, Q7.8 to Q11.4 for the
+ *              batch encoder, and tenths and text for MQTT and the LCD. Every
+ *              Q7.8 value is compared with a rounding computed in double,
+ *              with the halves (x.5 ulp) and negative freezer values included.
+ *              A long run checks that the running mean and variance do not
+ *              drift over days of readings.
+ *
+ *              Build from this directory:
+ *                  gcc -O2 -I.. -o temp_fixed_check temp_fixed_check.c \
+ *                      ../temp_fixed.c ../temp_stats.c -lm
+ * @version     0.1
+ * @date        2022-03-09
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "temp_fixed.h"
+#include "temp_stats.h"
+
+static unsigned long checks = 0, errors = 0;
+
+static void _expect(int ok, const char *stage, long value, long got, long want)
+{
+    checks++;
+    if (!ok && errors++ < 20)
+        fprintf(stderr, "%s: input %ld gave %ld, expected %ld\n", stage, value, got, want);
+}
+
+/* Rounds half away from zero, the rule of every narrowing in temp_fixed.c */
+static long _round(double value)
+{
+    return value < 0 ? -(long) floor(-value + 0.5) : (long) floor(value + 0.5);
+}
+
+/* Raw words and temperatures from the DS18B20 data sheet, table 1 */
+static void _check_raw(void)
+{
+    static const struct {
+        unsigned int raw;
+        double celsius;
+    } table[] = {
+        { 0x07D0, 125.0 }, { 0x0550, 85.0 }, { 0x0191, 25.0625 }, { 0x00A2, 10.125 },
+        { 0x0008, 0.5 }, { 0x0000, 0.0 }, { 0xFFF8, -0.5 }, { 0xFF5E, -10.125 },
+        { 0xFE6F, -25.0625 }, { 0xFC90, -55.0 },
+    };
+    unsigned i;
+
+    for (i = 0; i < sizeof table / sizeof table[0]; i++) {
+        long want = _round(table[i].celsius * 16);
+        temp_q4_t q4 = TEMP_Q4_FROM_RAW(table[i].raw);
+        temp_q4_t dirty = TEMP_Q4_FROM_RAW(table[i].raw | 0xABCD0000u);   // Bits above the word
+        temp_q8_t q8 = temp_q4_to_q8(q4);
+
+        _expect(q4 == want, "raw to Q11.4", table[i].raw, q4, want);
+        _expect(dirty == want, "raw with high bits to Q11.4", table[i].raw, dirty, want);
+        _expect(q8 == _round(table[i].celsius * 256), "Q11.4 to Q7.8", q4, q8,
+                _round(table[i].celsius * 256));
+        _expect(temp_q8_to_q4(q8) == q4, "Q7.8 to Q11.4 round trip", q8, temp_q8_to_q4(q8), q4);
+    }
+}
+
+/* Every Q7.8 value through the narrowing and the text conversions */
+static void _check_q8(void)
+{
+    long value;
+
+    for (value = INT16_MIN; value <= INT16_MAX; value++) {
+        temp_q8_t q8 = (temp_q8_t) value;
+        double celsius = value / 256.0;
+        long tenths = _round(celsius * 10);
+        char got[TEMP_Q8_STRING_LENGTH + 8], want[32];
+
+        _expect(temp_q8_to_q4(q8) == _round(celsius * 16), "Q7.8 to Q11.4", value,
+                temp_q8_to_q4(q8), _round(celsius * 16));
+        _expect(temp_q8_to_tenths(q8) == tenths, "Q7.8 to tenths", value,
+                temp_q8_to_tenths(q8), tenths);
+
+        snprintf(want, sizeof want, "%s%ld.%ld", tenths < 0 ? "-" : "", labs(tenths) / 10, labs(tenths) % 10);
+        _expect(temp_q8_format(got, q8) == (int) strlen(want) && !strcmp(got, want),
+                "Q7.8 format", value, (long) strlen(got), (long) strlen(want));
+        _expect(strlen(got) < TEMP_Q8_STRING_LENGTH, "Q7.8 format length", value,
+                (long) strlen(got), TEMP_Q8_STRING_LENGTH - 1);
+    }
+}
+
+/* Narrowing from the statistics precision, halves and saturation included */
+static void _check_round(void)
+{
+    const uint8_t frac_bits = TEMP_Q8_FRAC_BITS + TEMP_STATS_FRAC_BITS;
+    const long one = 1L << TEMP_STATS_FRAC_BITS;
+    long q8, offset;
+
+    for (q8 = -2000; q8 <= 2000; q8++) {
+        for (offset = -one / 2 - 1; offset <= one / 2 + 1; offset++) {
+            long value = q8 * one + offset;
+            long want = _round((double) value / one);
+            temp_q8_t got = temp_q8_round((int32_t) value, frac_bits);
+
+            _expect(got == want, "Q7.8 narrowing", value, got, want);
+        }
+    }
+    _expect(temp_q8_round(INT32_MAX, frac_bits) == INT16_MAX, "Q7.8 saturation", INT32_MAX,
+            temp_q8_round(INT32_MAX, frac_bits), INT16_MAX);
+    _expect(temp_q8_round(INT32_MIN + 1, frac_bits) == INT16_MIN, "Q7.8 saturation", INT32_MIN + 1,
+            temp_q8_round(INT32_MIN + 1, frac_bits), INT16_MIN);
+    _expect(temp_q8_round(-300, TEMP_Q8_FRAC_BITS) == -300, "Q7.8 without extra bits", -300,
+            temp_q8_round(-300, TEMP_Q8_FRAC_BITS), -300);
+}
+
+/* Thresholds as written in the source */
+static void _check_constants(void)
+{
+    long tenths;
+
+    for (tenths = -1280; tenths <= 1270; tenths++) {
+        long want = _round(tenths * 25.6);
+        _expect(TEMP_Q8_FROM_TENTHS(tenths) == want, "TEMP_Q8_FROM_TENTHS", tenths,
+                TEMP_Q8_FROM_TENTHS(tenths), want);
+        _expect(temp_q8_to_tenths(TEMP_Q8_FROM_TENTHS(tenths)) == tenths, "tenths round trip",
+                tenths, temp_q8_to_tenths(TEMP_Q8_FROM_TENTHS(tenths)), tenths);
+    }
+    _expect(TEMP_Q8_FROM_INT(-18) == -18 * 256, "TEMP_Q8_FROM_INT", -18, TEMP_Q8_FROM_INT(-18), -18 * 256);
+}
+
+/* A window of a steady freezer reading, and one that straddles a half */
+static void _check_stats(void)
+{
+    const uint8_t frac_bits = TEMP_Q8_FRAC_BITS + TEMP_STATS_FRAC_BITS;
+    temp_stats_t stats;
+    long sample, i;
+
+    for (sample = -6000; sample <= 6000; sample += 37) {
+        temp_stats_init(&stats, TEMP_STATS_ALPHA(1, 4));
+        for (i = 0; i < TEMP_STATS_WINDOW_SIZE; i++)
+            temp_stats_update(&stats, (int32_t) sample);
+        _expect(temp_q8_round(temp_stats_window_mean(&stats), frac_bits) == sample,
+                "steady window mean", sample, temp_q8_round(temp_stats_window_mean(&stats), frac_bits), sample);
+
+        /* Half the window one ulp higher: the mean is exactly x.5 ulp */
+        temp_stats_init(&stats, TEMP_STATS_ALPHA(1, 4));
+        for (i = 0; i < TEMP_STATS_WINDOW_SIZE; i++)
+            temp_stats_update(&stats, (int32_t) (sample + (i & 1)));
+        _expect(temp_q8_round(temp_stats_window_mean(&stats), frac_bits) == _round(sample + 0.5),
+                "half ulp window mean", sample, temp_q8_round(temp_stats_window_mean(&stats), frac_bits),
+                _round(sample + 0.5));
+    }
+}
+
+/* Days of 1 Hz readings: a step between two steady halves, then noise around
+   a freezer setpoint. The mean must stay exact, the variance within 0.1 %. */
+static void _check_long_run(void)
+{
+    const long n = 200000;
+    temp_stats_t stats;
+    __int128 sum = 0, squares = 0, count = 0;
+    uint32_t noise = 12345;
+    long i;
+
+    temp_stats_init(&stats, TEMP_STATS_ALPHA(1, 4));
+    for (i = 0; i < 4 * n; i++) {
+        int32_t sample;
+
+        if (i < n)
+            sample = TEMP_Q8_FROM_INT(4);
+        else if (i < 2 * n)
+            sample = TEMP_Q8_FROM_INT(5);
+        else {
+            noise = noise * 1103515245u + 12345u;
+            sample = TEMP_Q8_FROM_INT(-18) + (int32_t) ((noise >> 16) % 129) - 64;
+        }
+        temp_stats_update(&stats, sample);
+        sum += sample;
+        squares += (__int128) sample * sample;
+        count++;
+
+        if (i == 2 * n - 1 || i == 4 * n - 1) {
+            long want_mean = _round((double) sum * (1 << TEMP_STATS_FRAC_BITS) / (double) count);
+            double variance = (double) (count * squares - sum * sum) / (double) (count * (count - 1));
+            long want_variance = _round(variance * (1 << TEMP_STATS_FRAC_BITS));
+            long got_variance = temp_stats_variance(&stats);
+
+            _expect(temp_stats_mean(&stats) == want_mean, "long run mean", i + 1,
+                    temp_stats_mean(&stats), want_mean);
+            _expect(labs(got_variance - want_variance) <= 1 + want_variance / 1000,
+                    "long run variance", i + 1, got_variance, want_variance);
+        }
+    }
+}
+
+int main(void)
+{
+    _check_raw();
+    _check_q8();
+    _check_round();
+    _check_constants();
+    _check_stats();
+    _check_long_run();
+    printf("%lu checks, %lu errors\n", checks, errors);
+    return errors != 0;
+}
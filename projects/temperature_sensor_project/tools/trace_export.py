@@ -0,0 +1,161 @@
+"""Converter from binary trace packets (see trace.h) to Chrome trace JSON.
+
+Packets are read from files holding one or more packets back to back, e.g.
+saved with ``mosquitto_sub -N -t home/sensors/trace/refrigerator/1 > trace.bin``.
+Usage::
+
+    $ python trace_export.py trace.bin > trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev. Interrupt
+handlers get one track per IRQ, everything else is on the main track.
+
+Time stamps are mcycle counts, which run at the core clock of the moment. The
+clock is known at the end of every packet (header) and at every switch (clock
+events), and each stretch between two of them is converted at its own clock.
+Give all files of one run in one call, so the stretches join up.
+"""
+import bisect
+import json
+import struct
+import sys
+
+TRACE_VERSION = 1
+HEADER = struct.Struct("<2sBBIIQ")
+EVENT = struct.Struct("<IBBH")
+
+# Keep in sync with TRACE_EVENT in trace.h
+EVENTS = {
+    1: "irq",
+    2: "at_command",
+    3: "mqtt_publish",
+    4: "sensor_sample",
+    5: "lcd_frame",
+    6: "at_timeout",
+    7: "clock",
+}
+
+CLOCK_EVENT = 7
+
+PHASES = {0: "i", 1: "B", 2: "E"}
+
+IRQ_NAMES = {
+    3: "msip",
+    7: "mtimer (1-wire)",
+    34: "DMA0_CH4 (LCD)",
+    56: "USART0",
+}
+
+
+def decode_packets(data: bytes) -> tuple:
+    """Decode back to back packets.
+
+    :return: List of (mcycle, event, phase, argument) tuples, list of clock
+             points as (mcycle, Hz before, Hz after) and the number of lost
+             events, as (events, clocks, lost).
+    :rtype: tuple
+    """
+    events = []
+    clocks = []
+    lost = 0
+    position = 0
+    while position + HEADER.size <= len(data):
+        magic, version, count, core_hz, packet_lost, now = HEADER.unpack_from(data, position)
+        if magic != b"TR" or version != TRACE_VERSION:
+            raise ValueError("No trace packet at offset %d." % position)
+        position += HEADER.size
+        if position + count * EVENT.size > len(data):
+            raise ValueError("Packet at offset %d is truncated." % (position - HEADER.size))
+        lost += packet_lost
+        clocks.append((now, core_hz, core_hz))
+
+        for _ in range(count):
+            time, event, phase, argument = EVENT.unpack_from(data, position)
+            position += EVENT.size
+            # Time stamps are the low 32 bits of mcycle, all taken before 'now'
+            cycles = now - ((now - time) & 0xFFFFFFFF)
+            events.append((cycles, event, phase, argument))
+            if event == CLOCK_EVENT:
+                clocks.append((cycles, (argument >> 8) * 1000000, (argument & 0xFF) * 1000000))
+    return events, clocks, lost
+
+
+def to_seconds(events: list, clocks: list) -> list:
+    """Convert the mcycle time stamps of decoded events to seconds.
+
+    Only the first field of an event is used, the rest is passed on, so
+    log_decode.py converts its messages with this too.
+
+    :return: List of (time in s, event, phase, argument) tuples.
+    :rtype: list
+    """
+    if not events:
+        return []
+    clocks = sorted(clocks)
+    # (mcycle, seconds, Hz after) at every clock point. Seconds count from
+    # reset, at the clock before the first point until it.
+    anchors = [(clocks[0][0], clocks[0][0] / clocks[0][1], clocks[0][2])]
+    for cycles, _, hz in clocks[1:]:
+        last_cycles, last_seconds, last_hz = anchors[-1]
+        anchors.append((cycles, last_seconds + (cycles - last_cycles) / last_hz, hz))
+    starts = [anchor[0] for anchor in anchors]
+
+    converted = []
+    for cycles, *rest in events:
+        index = bisect.bisect_right(starts, cycles) - 1
+        if index < 0:
+            # Before the first clock point, at the clock it switched from
+            seconds = cycles / clocks[0][1]
+        else:
+            anchor_cycles, anchor_seconds, hz = anchors[index]
+            seconds = anchor_seconds + (cycles - anchor_cycles) / hz
+        converted.append((seconds, *rest))
+    return converted
+
+
+def to_chrome(events: list) -> dict:
+    trace = []
+    if not events:
+        return {"traceEvents": trace}
+    start = min(event[0] for event in events)
+
+    for time, event, phase, argument in sorted(events, key=lambda event: event[0]):
+        name = EVENTS.get(event, "event_%d" % event)
+        record = {"name": name, "ph": PHASES.get(phase, "i"), "ts": (time - start) * 1e6,
+                  "pid": 1, "tid": 0}
+        if event == 1:
+            record["name"] = IRQ_NAMES.get(argument, "irq %d" % argument)
+            record["tid"] = 1000 + argument
+        elif event == 4:
+            record["args"] = {"celsius": struct.unpack("<h", struct.pack("<H", argument))[0] / 256}
+        elif event == CLOCK_EVENT:
+            record["args"] = {"from_mhz": argument >> 8, "to_mhz": argument & 0xFF}
+        elif phase != 2:
+            record["args"] = {"argument": argument}
+        if record["ph"] == "i":
+            record["s"] = "t"
+        trace.append(record)
+
+    trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": 0, "args": {"name": "main"}})
+    for irq in sorted({argument for _, event, _, argument in events if event == 1}):
+        trace.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": 1000 + irq,
+                      "args": {"name": IRQ_NAMES.get(irq, "irq %d" % irq)}})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print("usage: python trace_export.py trace.bin... > trace.json")
+        exit(2)
+
+    all_events = []
+    all_clocks = []
+    all_lost = 0
+    for path in sys.argv[1:]:
+        with open(path, "rb") as trace_file:
+            file_events, file_clocks, file_lost = decode_packets(trace_file.read())
+        all_events += file_events
+        all_clocks += file_clocks
+        all_lost += file_lost
+
+    json.dump(to_chrome(to_seconds(all_events, all_clocks)), sys.stdout)
+    print("trace_export: %d events, %d lost" % (len(all_events), all_lost), file=sys.stderr)
@@ -0,0 +1,85 @@
+"""Decoder for the binary batched temperature payloads published on home/sensors/batch/...
+
+The format is described in ts_codec.h. Usage as a library::
+
+    from ts_decode import decode_batch
+    for timestamp_ms, celsius in decode_batch(payload):
+        ...
+
+or from the command line on a payload saved to a file (e.g. with mosquitto_sub -N)::
+
+    $ python ts_decode.py payload.bin
+"""
+import struct
+import sys
+
+TS_CODEC_VERSION = 1
+TS_CODEC_HEADER_BYTES = 8
+
+DOD_BUCKET_BITS = (0, 7, 9, 12, 32)
+TEMP_BUCKET_BITS = (0, 3, 6, 10, 17)
+
+
+class _BitReader:
+    """MSB first bit reader over a bytes object."""
+
+    def __init__(self, data: bytes):
+        self.data = data
+        self.position = 0
+
+    def read(self, count: int) -> int:
+        value = 0
+        for _ in range(count):
+            byte = self.position >> 3
+            if byte >= len(self.data):
+                raise ValueError("Payload is truncated.")
+            value = (value << 1) | ((self.data[byte] >> (7 - (self.position & 7))) & 1)
+            self.position += 1
+        return value
+
+    def read_coded(self, bucket_bits: tuple) -> int:
+        bucket = 0
+        while bucket < len(bucket_bits) - 1 and self.read(1):
+            bucket += 1
+        zigzag = self.read(bucket_bits[bucket])
+        return (zigzag >> 1) ^ -(zigzag & 1)
+
+
+def decode_batch(payload: bytes) -> list:
+    """Decode a batch payload.
+
+    :param payload: The binary MQTT message.
+    :type payload: bytes
+
+    :return: List of (timestamp in ms, temperature in degrees Celsius) tuples.
+    :rtype: list
+    """
+    if not isinstance(payload, (bytes, bytearray)):
+        raise TypeError("The payload (payload) can only be bytes.")
+    if len(payload) < TS_CODEC_HEADER_BYTES or payload[0] != TS_CODEC_VERSION:
+        raise ValueError("Unknown payload version or truncated header.")
+
+    count = payload[1]
+    timestamp_ms, temp_q4 = struct.unpack_from("<Ih", payload, 2)
+    readings = [(timestamp_ms, temp_q4 / 16)] if count else []
+
+    reader = _BitReader(payload[TS_CODEC_HEADER_BYTES:])
+    delta_ms = 0
+    for _ in range(count - 1):
+        delta_ms = (delta_ms + reader.read_coded(DOD_BUCKET_BITS)) & 0xFFFFFFFF
+        delta_ms = delta_ms - (1 << 32) if delta_ms & 0x80000000 else delta_ms
+        timestamp_ms = (timestamp_ms + delta_ms) & 0xFFFFFFFF
+        temp_q4 = (temp_q4 + reader.read_coded(TEMP_BUCKET_BITS) + 0x8000) % 0x10000 - 0x8000
+        readings.append((timestamp_ms, temp_q4 / 16))
+
+    return readings
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print("usage: python ts_decode.py payload.bin")
+        exit(2)
+
+    with open(sys.argv[1], "rb") as payload_file:
+        for reading_ms, reading_celsius in decode_batch(payload_file.read()):
+            print(str(reading_ms) + "," + str(reading_celsius))
@@ -0,0 +1,75 @@
+/**
+ * @file        trace.c
+ * @brief       Event ring and packet encoder of the binary trace.
+ * @version     0.1
+ * @date        2022-03-18
+ */
+
+#include "trace.h"
+#include "gd32vf103.h"
+
+trace_event_t trace_ring[TRACE_SIZE];
+uint32_t trace_head;                    // Events recorded since reset, may be set from interrupts
+static uint32_t trace_tail;             // Events drained
+
+static uint8_t *_put32(uint8_t *out, uint32_t value)
+{
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+    return out + 4;
+}
+
+/**
+ * @brief       Packs the events recorded since the last drain into a packet
+ *              (see trace.h). Events that do not fit stay for the next drain.
+ *              Call from the main loop only.
+ *
+ * @param[out]  buffer: where the packet is written.
+ * @param[in]   size: size of the buffer, at least TRACE_HEADER_BYTES.
+ *
+ * @return      The length of the packet, 0 if the buffer is too small.
+ */
+uint32_t trace_drain(uint8_t *buffer, uint32_t size)
+{
+    uint32_t head = __atomic_load_n(&trace_head, __ATOMIC_RELAXED);
+    uint64_t now = get_cycle_value();
+    uint32_t lost = 0, count, i;
+    uint8_t *out = buffer;
+
+    if (size < TRACE_HEADER_BYTES)
+        return 0;
+
+    /* The ring only holds the latest TRACE_SIZE events */
+    if (head - trace_tail > TRACE_SIZE) {
+        lost = head - trace_tail - TRACE_SIZE;
+        trace_tail = head - TRACE_SIZE;
+    }
+    count = head - trace_tail;
+    if (count > (size - TRACE_HEADER_BYTES) / TRACE_EVENT_BYTES)
+        count = (size - TRACE_HEADER_BYTES) / TRACE_EVENT_BYTES;
+    if (count > 255)
+        count = 255;
+
+    *out++ = 'T';
+    *out++ = 'R';
+    *out++ = TRACE_VERSION;
+    *out++ = count;
+    out = _put32(out, SystemCoreClock);
+    out = _put32(out, lost);
+    out = _put32(out, now);
+    out = _put32(out, now >> 32);
+
+    for (i = 0; i < count; i++) {
+        const trace_event_t *event = &trace_ring[(trace_tail + i) & TRACE_MASK];
+
+        out = _put32(out, event->time);
+        *out++ = event->event;
+        *out++ = event->phase;
+        *out++ = event->argument;
+        *out++ = event->argument >> 8;
+    }
+    trace_tail += count;
+    return out - buffer;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file        trace.h
+ * @brief       Binary event trace. Events are 8-byte records (mcycle time
+ *              stamp, event, phase, 16-bit argument) in a ring that always
+ *              holds the latest TRACE_SIZE events. Recording claims a slot with
+ *              one atomic add, so it works from any context without locks and
+ *              costs about a dozen instructions.
+ *
+ *              trace_drain() packs the events recorded since the last drain
+ *              into a packet:
+ *
+ *                  offset  size
+ *                  0       2       "TR"
+ *                  2       1       TRACE_VERSION
+ *                  3       1       number of events
+ *                  4       4       core clock in Hz
+ *                  8       4       events lost (overwritten) before these
+ *                  12      8       mcycle when the packet was made
+ *                  20      8 * n   events: time (low 32 bits of mcycle),
+ *                                  event, phase, argument
+ *
+ *              all little-endian. The core clock is the one at the drain;
+ *              TRACE_CLOCK events mark the switches in between, as mcycle
+ *              counts at the clock of the moment. tools/trace_export.py turns
+ *              packets into Chrome trace JSON (chrome://tracing, Perfetto).
+ * @version     0.1
+ * @date        2022-03-18
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "stdint.h"
+#include "riscv_encoding.h"
+
+/**
+ * @brief If defined, the trace points are compiled in.
+ */
+#define TRACE
+
+/**
+ * @brief If defined, a trace packet is published over MQTT every
+ *        TRACE_PUBLISH_READINGS sensor readings.
+ */
+//#define TRACE_PUBLISH
+#define TRACE_PUBLISH_READINGS  60
+
+#define TRACE_VERSION           1
+#define TRACE_SIZE              256     // Events in the ring, a power of two
+#define TRACE_MASK              (TRACE_SIZE - 1)
+#define TRACE_HEADER_BYTES      20
+#define TRACE_EVENT_BYTES       8
+
+/**
+ * @brief Traced events. Keep in sync with EVENTS in tools/trace_export.py.
+ */
+typedef enum {
+    TRACE_IRQ = 1,              // Interrupt handler, argument is the IRQ number
+    TRACE_AT_COMMAND,           // AT command until its response or timeout
+    TRACE_MQTT_PUBLISH,         // Argument is the payload length
+    TRACE_SENSOR_SAMPLE,        // Argument is the temperature in Q7.8
+    TRACE_LCD_FRAME,            // Status display redraw
+    TRACE_AT_TIMEOUT,
+    TRACE_CLOCK                 // Core clock switch, argument is old MHz << 8 | new MHz
+} TRACE_EVENT;
+
+typedef enum {
+    TRACE_PHASE_INSTANT,
+    TRACE_PHASE_BEGIN,
+    TRACE_PHASE_END
+} TRACE_PHASE;
+
+typedef struct {
+    uint32_t time;
+    uint8_t event;
+    uint8_t phase;
+    uint16_t argument;
+} trace_event_t;
+
+#ifdef TRACE
+
+extern trace_event_t trace_ring[TRACE_SIZE];
+extern uint32_t trace_head;
+
+/**
+ * @brief Records an event. May be called from interrupts; an interrupted
+ *        record keeps its slot, so events are never mixed up.
+ */
+static inline void trace_record(uint8_t event, uint8_t phase, uint16_t argument)
+{
+    trace_event_t *slot = &trace_ring[__atomic_fetch_add(&trace_head, 1, __ATOMIC_RELAXED) & TRACE_MASK];
+
+    slot->time = read_csr(mcycle);
+    slot->event = event;
+    slot->phase = phase;
+    slot->argument = argument;
+}
+
+#define TRACE_BEGIN(event, argument)    trace_record(event, TRACE_PHASE_BEGIN, argument)
+#define TRACE_END(event, argument)      trace_record(event, TRACE_PHASE_END, argument)
+#define TRACE_INSTANT(event, argument)  trace_record(event, TRACE_PHASE_INSTANT, argument)
+
+#else
+
+#define TRACE_BEGIN(event, argument)    do { } while (0)
+#define TRACE_END(event, argument)      do { } while (0)
+#define TRACE_INSTANT(event, argument)  do { } while (0)
+
+#endif /* TRACE */
+
+uint32_t trace_drain(uint8_t *buffer, uint32_t size);
+
+#endif /* TRACE_H */
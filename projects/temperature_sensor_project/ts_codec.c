@@ -0,0 +1,238 @@
+/**
+ * @file        ts_codec.c
+ * @brief       Compact encoding of batched temperature readings for binary MQTT
+ *              payloads (delta-of-delta timestamps, zig-zag temperature deltas),
+ *              with a matching decoder for the consumer side. See ts_codec.h.
+ * @version     0.1
+ * @date        2022-03-11
+ */
+
+#include "ts_codec.h"
+#include <string.h>
+
+/**
+ * @brief Prefix code buckets: a value with n leading ones (and a terminating zero,
+ *        except for the last bucket) is followed by bucket_bits[n] payload bits.
+ */
+static const uint8_t dod_bucket_bits[] = {0, 7, 9, 12, 32};
+static const uint8_t temp_bucket_bits[] = {0, 3, 6, 10, 17};
+#define BUCKETS 5
+
+static uint32_t _zigzag(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t _unzigzag(uint32_t value)
+{
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+static void _put_bits(ts_encoder_t *encoder, uint32_t value, uint8_t count)
+{
+    while (count--) {
+        uint32_t byte = TS_CODEC_HEADER_BYTES + (encoder->bits >> 3);
+        uint8_t mask = 0x80 >> (encoder->bits & 7);
+
+        if (value & ((uint32_t) 1 << count))
+            encoder->buffer[byte] |= mask;
+        else
+            encoder->buffer[byte] &= ~mask;
+        encoder->bits++;
+    }
+}
+
+static void _put_coded(ts_encoder_t *encoder, int32_t value, const uint8_t *bucket_bits)
+{
+    uint32_t zigzag = _zigzag(value);
+    uint8_t bucket = 0;
+
+    while (bucket < BUCKETS - 1 && (bucket_bits[bucket] < 32 && zigzag >> bucket_bits[bucket]))
+        bucket++;
+
+    /* n ones, then a zero unless it's the last bucket */
+    _put_bits(encoder, (1u << bucket) - 1, bucket);
+    if (bucket < BUCKETS - 1)
+        _put_bits(encoder, 0, 1);
+    _put_bits(encoder, zigzag, bucket_bits[bucket]);
+}
+
+static void _put_le(uint8_t *buffer, uint32_t value, uint8_t bytes)
+{
+    while (bytes--) {
+        *buffer++ = (uint8_t) value;
+        value >>= 8;
+    }
+}
+
+static uint32_t _get_le(const uint8_t *buffer, uint8_t bytes)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < bytes; i++)
+        value |= (uint32_t) buffer[i] << (8 * i);
+    return value;
+}
+
+/**
+ * @brief       Starts a new batch.
+ *
+ * @param[out]  encoder: the encoder.
+ * @param[in]   buffer: where the payload is written.
+ * @param[in]   capacity: size of buffer, at least TS_CODEC_HEADER_BYTES.
+ *
+ * @return      None.
+ */
+void ts_encoder_init(ts_encoder_t *encoder, uint8_t *buffer, uint16_t capacity)
+{
+    encoder->buffer = buffer;
+    encoder->capacity = capacity;
+    encoder->bits = 0;
+    encoder->count = 0;
+    encoder->previous_ms = 0;
+    encoder->previous_delta_ms = 0;
+    encoder->previous_temp = 0;
+}
+
+/**
+ * @brief       Appends a reading to the batch.
+ *
+ * @param[out]  encoder: the encoder.
+ * @param[in]   timestamp_ms: when the reading was taken.
+ * @param[in]   temp: the reading in Q11.4.
+ *
+ * @return      false if the batch is full (nothing is written), true otherwise.
+ */
+bool ts_encoder_add(ts_encoder_t *encoder, uint32_t timestamp_ms, temp_q4_t temp)
+{
+    if (encoder->count == TS_CODEC_MAX_READINGS)
+        return false;
+
+    if (encoder->count == 0) {
+        if (encoder->capacity < TS_CODEC_HEADER_BYTES)
+            return false;
+        encoder->buffer[0] = TS_CODEC_VERSION;
+        _put_le(&encoder->buffer[2], timestamp_ms, 4);
+        _put_le(&encoder->buffer[6], (uint16_t) temp, 2);
+    } else {
+        /* Check for the worst case up front so an entry is never cut in half */
+        if (TS_CODEC_HEADER_BYTES + ((encoder->bits + 7) >> 3) + TS_CODEC_MAX_ENTRY_BYTES > encoder->capacity)
+            return false;
+
+        int32_t delta_ms = (int32_t) (timestamp_ms - encoder->previous_ms);
+        _put_coded(encoder, delta_ms - encoder->previous_delta_ms, dod_bucket_bits);
+        _put_coded(encoder, temp - encoder->previous_temp, temp_bucket_bits);
+        encoder->previous_delta_ms = delta_ms;
+    }
+
+    encoder->previous_ms = timestamp_ms;
+    encoder->previous_temp = temp;
+    encoder->count++;
+    return true;
+}
+
+/**
+ * @brief       Completes the header and pads the bit stream to a whole byte.
+ *
+ * @param[out]  encoder: the encoder.
+ *
+ * @return      the payload length in bytes, 0 if the batch is empty.
+ */
+uint16_t ts_encoder_finish(ts_encoder_t *encoder)
+{
+    if (!encoder->count)
+        return 0;
+
+    if (encoder->bits & 7)
+        _put_bits(encoder, 0, 8 - (encoder->bits & 7));
+    encoder->buffer[1] = encoder->count;
+    return TS_CODEC_HEADER_BYTES + (encoder->bits >> 3);
+}
+
+static bool _get_bits(ts_decoder_t *decoder, uint8_t count, uint32_t *value)
+{
+    *value = 0;
+    while (count--) {
+        uint32_t byte = TS_CODEC_HEADER_BYTES + (decoder->bits >> 3);
+        if (byte >= decoder->length)
+            return false;
+        *value = (*value << 1) | ((decoder->buffer[byte] >> (7 - (decoder->bits & 7))) & 1);
+        decoder->bits++;
+    }
+    return true;
+}
+
+static bool _get_coded(ts_decoder_t *decoder, const uint8_t *bucket_bits, int32_t *value)
+{
+    uint8_t bucket = 0;
+    uint32_t bit, zigzag;
+
+    while (bucket < BUCKETS - 1) {
+        if (!_get_bits(decoder, 1, &bit))
+            return false;
+        if (!bit)
+            break;
+        bucket++;
+    }
+
+    if (!_get_bits(decoder, bucket_bits[bucket], &zigzag))
+        return false;
+    *value = _unzigzag(zigzag);
+    return true;
+}
+
+/**
+ * @brief       Starts decoding a payload.
+ *
+ * @param[out]  decoder: the decoder.
+ * @param[in]   buffer: the payload.
+ * @param[in]   length: the payload length in bytes.
+ *
+ * @return      false if the payload is truncated or of an unknown version.
+ */
+bool ts_decoder_init(ts_decoder_t *decoder, const uint8_t *buffer, uint16_t length)
+{
+    if (length < TS_CODEC_HEADER_BYTES || buffer[0] != TS_CODEC_VERSION)
+        return false;
+
+    decoder->buffer = buffer;
+    decoder->length = length;
+    decoder->bits = 0;
+    decoder->count = buffer[1];
+    decoder->decoded = 0;
+    decoder->previous_ms = 0;
+    decoder->previous_delta_ms = 0;
+    decoder->previous_temp = 0;
+    return true;
+}
+
+/**
+ * @brief       Decodes the next reading.
+ *
+ * @param[out]  decoder: the decoder.
+ * @param[out]  timestamp_ms: when the reading was taken.
+ * @param[out]  temp: the reading in Q11.4.
+ *
+ * @return      false when all readings have been decoded or the payload is corrupt.
+ */
+bool ts_decoder_next(ts_decoder_t *decoder, uint32_t *timestamp_ms, temp_q4_t *temp)
+{
+    if (decoder->decoded == decoder->count)
+        return false;
+
+    if (decoder->decoded == 0) {
+        decoder->previous_ms = _get_le(&decoder->buffer[2], 4);
+        decoder->previous_temp = (temp_q4_t) _get_le(&decoder->buffer[6], 2);
+    } else {
+        int32_t dod, delta;
+        if (!_get_coded(decoder, dod_bucket_bits, &dod) || !_get_coded(decoder, temp_bucket_bits, &delta))
+            return false;
+        decoder->previous_delta_ms += dod;
+        decoder->previous_ms += decoder->previous_delta_ms;
+        decoder->previous_temp += delta;
+    }
+
+    decoder->decoded++;
+    *timestamp_ms = decoder->previous_ms;
+    *temp = decoder->previous_temp;
+    return true;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file        ts_codec.h
+ * @brief       Compact encoding of batched temperature readings for binary MQTT
+ *              payloads, with a matching decoder for the consumer side.
+ *
+ *              Payload layout (multi-byte fields little endian):
+ *                  [0]     version (TS_CODEC_VERSION)
+ *                  [1]     number of readings
+ *                  [2..5]  timestamp of the first reading (ms)
+ *                  [6..7]  temperature of the first reading (Q11.4)
+ *                  [8..]   bit stream (MSB first), per following reading:
+ *                          timestamp delta-of-delta, zig-zag, prefix coded
+ *                              0                   dod == 0
+ *                              10   + 7 bits       |dod| < 64
+ *                              110  + 9 bits       |dod| < 256
+ *                              1110 + 12 bits      |dod| < 2048
+ *                              1111 + 32 bits      otherwise
+ *                          temperature delta (Q11.4), zig-zag, prefix coded
+ *                              0                   delta == 0
+ *                              10   + 3 bits       |delta| < 4
+ *                              110  + 6 bits       |delta| < 32
+ *                              1110 + 10 bits      |delta| < 512
+ *                              1111 + 17 bits      otherwise
+ * @version     0.1
+ * @date        2022-03-11
+ */
+
+#ifndef TS_CODEC_H
+#define TS_CODEC_H
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "temp_fixed.h"
+
+#define TS_CODEC_VERSION        1
+#define TS_CODEC_HEADER_BYTES   8
+#define TS_CODEC_MAX_READINGS   255
+
+/**
+ * @brief Largest encoding of one reading after the first (4 + 32 + 4 + 17 bits).
+ */
+#define TS_CODEC_MAX_ENTRY_BYTES 8
+
+/**
+ * @brief Encoder writing into a caller supplied buffer.
+ */
+typedef struct {
+    uint8_t *buffer;
+    uint16_t capacity;
+    uint32_t bits;              // Bits written to the bit stream
+    uint8_t count;
+    uint32_t previous_ms;
+    int32_t previous_delta_ms;
+    temp_q4_t previous_temp;
+} ts_encoder_t;
+
+/**
+ * @brief Decoder reading from an encoded payload.
+ */
+typedef struct {
+    const uint8_t *buffer;
+    uint16_t length;
+    uint32_t bits;              // Bits read from the bit stream
+    uint8_t count;
+    uint8_t decoded;
+    uint32_t previous_ms;
+    int32_t previous_delta_ms;
+    temp_q4_t previous_temp;
+} ts_decoder_t;
+
+void ts_encoder_init(ts_encoder_t *encoder, uint8_t *buffer, uint16_t capacity);
+bool ts_encoder_add(ts_encoder_t *encoder, uint32_t timestamp_ms, temp_q4_t temp);
+uint16_t ts_encoder_finish(ts_encoder_t *encoder);
+
+bool ts_decoder_init(ts_decoder_t *decoder, const uint8_t *buffer, uint16_t length);
+bool ts_decoder_next(ts_decoder_t *decoder, uint32_t *timestamp_ms, temp_q4_t *temp);
+
+#endif /* TS_CODEC_H */
@@ -12,70 +12,122 @@
 #include "at_command.h"
 
 
+#include "ring.h"
+#include "ramfunc.h"
+#include "clock.h"
+#include <string.h>
+
+
 #define TRANSMIT_BUFFER_SIZE 256
 
-int last_data_added_to_transmit_buffer = 0,
-    last_data_transmitted_from_transmit_buffer = 0;
-uint8_t transmit_buffer_queue[TRANSMIT_BUFFER_SIZE]={0};
+RING_DEFINE(transmit_ring, uint8_t, TRANSMIT_BUFFER_SIZE)
+RING_DEFINE(recieve_ring, uint8_t, RECIEVE_BUFFER_SIZE)
 
-int last_added_data_in_recieve_buffer = 0,
-    last_data_read_from_recieve_buffer = 0;
-uint8_t recieve_buffer_queue[RECIEVE_BUFFER_SIZE]={0};
+static transmit_ring_t transmit_buffer_queue;   // Filled by putch, emptied by _u0_service
+static recieve_ring_t recieve_buffer_queue;     // Filled by _u0_service, emptied by getChar
+static int interrupt_enabled = 0;
 
 void (*uart_data_recieved_callback)(uint8_t recieved_data)=NULL;
 
-void u0_TX_Queue(void)
+/**
+ * @brief Moves one byte each way. The USART0 interrupt handler; the main loop
+ *        calls it through u0_TX_Queue. Runs from SRAM and uses the registers
+ *        directly, so no call goes out to the library in flash.
+ */
+RAMFUNC static void _u0_service(void)
 {
-    if (last_data_transmitted_from_transmit_buffer != last_data_added_to_transmit_buffer)
+    uint8_t data;
+
+    if (transmit_ring_count(&transmit_buffer_queue))
     {
-        if (usart_flag_get(USART0,USART_FLAG_TBE))
+        if (USART_STAT(USART0) & USART_STAT_TBE)
         {
-            usart_data_transmit(USART0, transmit_buffer_queue[last_data_transmitted_from_transmit_buffer++]);
-            last_data_transmitted_from_transmit_buffer %= TRANSMIT_BUFFER_SIZE;
+            transmit_ring_pop(&transmit_buffer_queue, &data);
+            USART_DATA(USART0) = data;
         }
     }
     else
     {
-        usart_interrupt_disable(USART0, USART_INT_TBE);
+        USART_CTL0(USART0) &= ~USART_CTL0_TBEIE;
     }
 
-    if (usart_flag_get(USART0, USART_FLAG_RBNE))
+    if (USART_STAT(USART0) & USART_STAT_RBNE)
     {
-        uint8_t rec_char = usart_data_receive(USART0);
-        recieve_buffer_queue[last_added_data_in_recieve_buffer] = rec_char;
-        last_added_data_in_recieve_buffer = (last_added_data_in_recieve_buffer + 1) % RECIEVE_BUFFER_SIZE;
+        uint8_t rec_char = USART_DATA(USART0);
+        recieve_ring_push(&recieve_buffer_queue, rec_char);    // Dropped if nobody reads
         uart_data_recieved_callback(rec_char);
     }
 }
 
+void u0_TX_Queue(void)
+{
+    // The rings have one producer and one consumer, so keep the handler out meanwhile
+    if (interrupt_enabled)
+        eclic_disable_interrupt(USART0_IRQn);
+    _u0_service();
+    if (interrupt_enabled)
+        eclic_enable_interrupt(USART0_IRQn);
+}
+
+int u0_TX_Empty(void)
+{
+    return !transmit_ring_count(&transmit_buffer_queue) && usart_flag_get(USART0, USART_FLAG_TC);
+}
+
 void putch(char ch)
 {
-    while (((last_data_transmitted_from_transmit_buffer + 1) % 256) == last_data_added_to_transmit_buffer)
+    while (!transmit_ring_push(&transmit_buffer_queue, ch))
     {
         u0_TX_Queue();
     }
-    transmit_buffer_queue[last_data_added_to_transmit_buffer++] = ch;
-    last_data_added_to_transmit_buffer %= 256;
     usart_interrupt_enable(USART0, USART_INT_TBE);
 }
 
 void putstr(char str[])
 {
-  while (*str) putch(*str++);
+    uint32_t length = strlen(str);
+
+    while (length)
+    {
+        uint32_t queued = transmit_ring_push_n(&transmit_buffer_queue, (const uint8_t *) str, length);
+        if (queued)
+            usart_interrupt_enable(USART0, USART_INT_TBE);
+        else
+            u0_TX_Queue();
+        str += queued;
+        length -= queued;
+    }
 }
 
 char getChar()
 {
-    if ( last_data_read_from_recieve_buffer == last_added_data_in_recieve_buffer)
+    uint8_t return_char;
+
+    if (!recieve_ring_pop(&recieve_buffer_queue, &return_char))
     {
         return '\0';
     }
-    char return_char = recieve_buffer_queue[last_data_read_from_recieve_buffer];
-    last_data_read_from_recieve_buffer = (last_data_read_from_recieve_buffer + 1) % RECIEVE_BUFFER_SIZE;
     return return_char;
-    
 }
 
+/**
+ * @brief Bytes in flight would be garbled by a new baud rate. An incoming byte
+ *        can't be seen coming and is lost if a switch hits it.
+ */
+static int _clock_ready(void)
+{
+    return u0_TX_Empty();
+}
+
+static void _clock_changed(uint32_t old_hz, uint32_t new_hz)
+{
+    (void) old_hz;
+    (void) new_hz;
+    usart_baudrate_set(USART0, U0_BAUD);    // Reads the new APB2 clock
+}
+
+static const clock_client_t clock_client = { _clock_ready, _clock_changed };
+
 void u0init(int enable, void (*data_recieve_callback)(uint8_t recieved_data)){
     rcu_periph_clock_enable(RCU_GPIOA);
     gpio_init(GPIOA, GPIO_MODE_AF_PP, GPIO_OSPEED_50MHZ, GPIO_PIN_9);
@@ -83,7 +135,7 @@ void u0init(int enable, void (*data_recieve_callback)(uint8_t recieved_data)){
 
     rcu_periph_clock_enable(RCU_USART0);
     usart_deinit(USART0);
-    usart_baudrate_set(USART0, 115200);
+    usart_baudrate_set(USART0, U0_BAUD);
     usart_parity_config(USART0, USART_PM_NONE);
     usart_word_length_set(USART0, USART_WL_8BIT);
     usart_stop_bit_set(USART0,USART_STB_1BIT);
@@ -93,11 +145,15 @@ void u0init(int enable, void (*data_recieve_callback)(uint8_t recieved_data)){
     usart_transmit_config(USART0,USART_TRANSMIT_ENABLE);
     usart_receive_config(USART0,USART_RECEIVE_ENABLE);
 
+    transmit_ring_init(&transmit_buffer_queue);
+    recieve_ring_init(&recieve_buffer_queue);
     if (enable) {
-        eclicw_enable(USART0_IRQn, 3, 1, &u0_TX_Queue);
+        eclicw_enable(USART0_IRQn, 3, 1, &_u0_service);
     }
+    interrupt_enabled = enable;
 
     uart_data_recieved_callback=data_recieve_callback;
 
     usart_interrupt_enable(USART0, USART_INT_RBNE);
+    clock_register(&clock_client);
 }
\ No newline at end of file
@@ -1,10 +1,12 @@
 #define RECIEVE_BUFFER_SIZE 512
+#define U0_BAUD 115200
 
 #include "gd32vf103.h"
 
 void u0init(int enable, void (*data_recieve_callback)(uint8_t recieved_data));
 
 void u0_TX_Queue(void);
+int u0_TX_Empty(void);
 
 void putch(char ch);
 void putstr(char str[]);